@@ -0,0 +1,141 @@
+# Copyright (c) 2011-2013, Take Vos
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+#   this list of conditions and the following disclaimer.
+# - Redistributions in binary form must reproduce the above copyright notice, 
+#   this list of conditions and the following disclaimer in the documentation 
+#   and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+
+import yyast
+
+class LazyNode (object):
+    """A node of a yyast file which is parsed when it is accessed.
+
+    The node only holds its offset in the mapped file. The header is parsed when node_info is accessed,
+    the offsets of the children when children is accessed, and the factories are called when node is
+    accessed. Memory is only used for the nodes that are visited.
+    """
+    __slots__ = ("parser", "symbol_table", "data", "offset", "end", "_node_info", "_children", "_node")
+
+    def __init__(self, parser, symbol_table, data, offset, end):
+        """
+        @param parser       The Parser, with the registered factories.
+        @param data         Data from a yyast file.
+        @param offset       Offset of the node in the data.
+        @param end          End of the data of the parent node, the node must fit before it.
+        """
+        self.parser = parser
+        self.symbol_table = symbol_table
+        self.data = data
+        self.offset = offset
+        self.end = end
+        self._node_info = None
+        self._children = None
+        self._node = None
+
+    @property
+    def node_info(self):
+        """The NodeInfo of the node."""
+        if self._node_info is None:
+            self._node_info, self.end = self.parser.parse_node_info(self.data, self.offset, self.end)
+        return self._node_info
+
+    @property
+    def children(self):
+        """The children of a branch as a list of LazyNode, an empty list for other nodes."""
+        if self._children is None:
+            children = []
+            if self.node_info.node_type == yyast.NODE_TYPE_BRANCH:
+                offset = self.offset + 32
+                while offset < self.end:
+                    node_info, next_offset = self.parser.parse_node_info(self.data, offset, self.end)
+
+                    # The offset index is only needed for random access, it is not part of the tree.
+                    if node_info.node_type != yyast.NODE_TYPE_INDEX:
+                        child = LazyNode(self.parser, self.symbol_table, self.data, offset, next_offset)
+                        child._node_info = node_info
+                        children.append(child)
+                    offset = next_offset
+            self._children = children
+        return self._children
+
+    @property
+    def node(self):
+        """The node created by the factories, with all its children.
+
+        The factories are called on first access, once for each node. The node of a child that was accessed
+        before is added to this node as it is, and when this node is accessed before its children, their
+        node property returns the nodes that were added to it.
+        """
+        if self._node is None:
+            self.build()
+        return self._node
+
+    def build(self):
+        """Call the factories for this node and the nodes below it which were not created yet.
+
+        The nodes are created in the same order as by Parser.parse(): the node of a branch before its children,
+        and parsing_done() after its children were added. The branches are kept on a stack, so that deep
+        trees do not run into the recursion limit.
+        """
+        if self.node_info.node_type != yyast.NODE_TYPE_BRANCH:
+            self._node = self.parse_value()
+            return
+
+        stack = [self.enter_branch()]
+        while stack:
+            lazy_node, node, children = stack[-1]
+            for child in children:
+                if child._node is None:
+                    if child.node_info.node_type == yyast.NODE_TYPE_BRANCH:
+                        stack.append(child.enter_branch())
+                        break
+                    child._node = child.parse_value()
+                node.add_child(child._node)
+
+            else:
+                node.parsing_done()
+                lazy_node._node = node
+                stack.pop()
+                if stack:
+                    stack[-1][1].add_child(node)
+
+    def enter_branch(self):
+        """Create the node of a branch, before its children are added.
+
+        @return lazy_node, node, children   This LazyNode, the new node and an iterator over the children.
+        """
+        factory = self.parser.find_factory(self.node_info)
+        return self, factory(self.symbol_table, self.node_info), iter(self.children)
+
+    def parse_value(self):
+        """Create the node of a node which is not a branch, with the subparser for its type.
+        """
+        factory = self.parser.find_factory(self.node_info)
+        subparser = self.parser.find_subparser(self.node_info)
+        return subparser(factory, self.symbol_table, self.node_info, self.data, self.offset + 32, self.end)
+
+    def __len__(self):
+        return len(self.children)
+
+    def __getitem__(self, i):
+        return self.children[i]
+
+    def __iter__(self):
+        return iter(self.children)
+
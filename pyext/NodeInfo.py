@@ -22,6 +22,8 @@
 # ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
 
 class NodeInfo (object):
+    __slots__ = ("node_type", "node_name", "node_size", "line_nr", "column_nr", "file_nr")
+
     def __init__(self, node_type=None, node_name=None, node_size=None, line_nr=None, column_nr=None, file_nr=None):
         self.node_type = node_type
         self.node_name = node_name
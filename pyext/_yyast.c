@@ -0,0 +1,505 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <yyast/reader.h>
+
+#if PY_MAJOR_VERSION >= 3
+#define YA_PY_BUFFER_FORMAT "y*nnOOOOO"
+#else
+#define YA_PY_BUFFER_FORMAT "s*nnOOOOO"
+#endif
+
+/** Interned method names of the nodes.
+ */
+static PyObject *ya_py_parsing_done;
+static PyObject *ya_py_add_child;
+
+/** The Python objects used while parsing, as passed to parse().
+ */
+typedef struct {
+    PyObject        *symbol_table;      ///< Passed as first argument to each factory.
+    PyObject        *factories;         ///< Dictionary of factories by node name.
+    PyObject        *node_info;         ///< The NodeInfo class.
+    PyObject        *decode_decimal;    ///< Function to convert the bits of a decimal float to a Decimal.
+    PyObject        *exception;         ///< The exception class for malformed files.
+} ya_py_parser_t;
+
+/** The branches of which the children are being parsed.
+ */
+typedef struct {
+    PyObject        **nodes;            ///< For each level, the node created by the factory.
+    size_t          depth;              ///< Number of levels on the stack.
+    size_t          capacity;           ///< Number of levels that fit in the stack.
+} ya_py_stack_t;
+
+/** Convert a line, column or file number to a Python value.
+ * @param x     The number from the position of a node.
+ * @returns     New reference to an integer, or None when the number is not known.
+ */
+static PyObject *ya_py_position(uint32_t x)
+{
+    if (x == UINT32_MAX) {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromUnsignedLong(x);
+}
+
+/** Convert the name of a node to bytes, without the white space padding.
+ * @param name  The name of the node.
+ * @returns     New reference to the name, or NULL on error.
+ */
+static PyObject *ya_py_name(ya_name_t name)
+{
+    char    buf[8];
+    size_t  first = 0;
+    size_t  last = sizeof (buf);
+    int     i;
+
+    for (i = 0; i < 8; i++) {
+        buf[i] = (name >> (56 - i * 8)) & 0xff;
+    }
+
+    // Strip the same characters as bytes.strip() does.
+    while (first < last && strchr(" \t\n\r\v\f", buf[first]) != NULL && buf[first] != '\0') {
+        first++;
+    }
+    while (last > first && strchr(" \t\n\r\v\f", buf[last - 1]) != NULL && buf[last - 1] != '\0') {
+        last--;
+    }
+    return PyBytes_FromStringAndSize(&buf[first], last - first);
+}
+
+/** Create the NodeInfo of a node.
+ * @param parser    The Python objects used while parsing.
+ * @param cursor    The node.
+ * @param name      The name of the node, without padding.
+ * @returns         New reference to the NodeInfo, or NULL on error.
+ */
+static PyObject *ya_py_node_info(const ya_py_parser_t *parser, const ya_cursor_t *cursor, PyObject *name)
+{
+    ya_position_t   position = ya_cursor_position(cursor);
+    PyObject        *args;
+    PyObject        *r;
+
+    // The arguments are passed by position, in the order of NodeInfo.__init__(), which is faster than by keyword.
+    args = Py_BuildValue("(iOKNNN)",
+        (int)ya_cursor_type(cursor),
+        name,
+        (unsigned long long)(ya_cursor_data_size(cursor) + sizeof (ya_node_t)),
+        ya_py_position(position.line),
+        ya_py_position(position.column),
+        ya_py_position(position.file)
+    );
+    if (args == NULL) {
+        return NULL;
+    }
+    r = PyObject_Call(parser->node_info, args, NULL);
+    Py_DECREF(args);
+    return r;
+}
+
+/** Convert the data of a node to a Python value.
+ * @param parser    The Python objects used while parsing.
+ * @param cursor    The node.
+ * @param value     New reference to the value, or NULL when the type of node has no value.
+ * @returns         0 on success, -1 on error with a Python exception set.
+ */
+static int ya_py_value(const ya_py_parser_t *parser, const ya_cursor_t *cursor, PyObject **value)
+{
+    const char  *data = ya_cursor_data(cursor);
+    size_t      data_size = ya_cursor_data_size(cursor);
+    uint64_t    value64;
+    uint128_t   value128;
+    double      d;
+    PyObject    *high;
+    PyObject    *low;
+    PyObject    *shift;
+    PyObject    *shifted;
+    PyObject    *bits;
+
+    *value = NULL;
+    switch (ya_cursor_type(cursor)) {
+    case YA_NODE_TYPE_NULL:
+        if (data_size > 0) {
+            PyErr_SetString(parser->exception, "Null node should not have data.");
+            return -1;
+        }
+        return 0;
+
+    case YA_NODE_TYPE_LEAF:
+        if (data_size > 0) {
+            PyErr_SetString(parser->exception, "Leaf node should not have data.");
+            return -1;
+        }
+        return 0;
+
+    case YA_NODE_TYPE_BRANCH:
+        return 0;
+
+    case YA_NODE_TYPE_TEXT:
+        // Only the padding at the end is stripped, the text may contain nul characters.
+        while (data_size > 0 && data[data_size - 1] == '\0') {
+            data_size--;
+        }
+        *value = PyUnicode_DecodeUTF8(data, data_size, NULL);
+        return *value == NULL ? -1 : 0;
+
+    case YA_NODE_TYPE_POSITIVE_INTEGER:
+        if (ya_cursor_uint64(cursor, &value64) == -1) {
+            PyErr_SetString(parser->exception, "Positive integer node should be exactly 64 bit.");
+            return -1;
+        }
+        *value = PyLong_FromUnsignedLongLong(value64);
+        return *value == NULL ? -1 : 0;
+
+    case YA_NODE_TYPE_NEGATIVE_INTEGER:
+        if (ya_cursor_uint64(cursor, &value64) == -1) {
+            PyErr_SetString(parser->exception, "Negative integer node should be exactly 64 bit.");
+            return -1;
+        }
+        if ((bits = PyLong_FromUnsignedLongLong(value64)) == NULL) {
+            return -1;
+        }
+        *value = PyNumber_Negative(bits);
+        Py_DECREF(bits);
+        return *value == NULL ? -1 : 0;
+
+    case YA_NODE_TYPE_BINARY_FLOAT:
+        if (ya_cursor_uint64(cursor, &value64) == -1) {
+            PyErr_SetString(parser->exception, "Binary float node should be exactly 64 bit.");
+            return -1;
+        }
+        memcpy(&d, &value64, sizeof (d));
+        *value = PyFloat_FromDouble(d);
+        return *value == NULL ? -1 : 0;
+
+    case YA_NODE_TYPE_DECIMAL_FLOAT:
+        if (ya_cursor_uint64(cursor, &value64) == 0) {
+            *value = PyObject_CallFunction(parser->decode_decimal, "Kiiiii", (unsigned long long)value64, 64, 10, 53, 398, 16);
+            return *value == NULL ? -1 : 0;
+        }
+        if (ya_cursor_uint128(cursor, &value128) == -1) {
+            PyErr_SetString(parser->exception, "Decimal float node should be exactly 64 or 128 bit.");
+            return -1;
+        }
+
+        // Python has no conversion from a 128 bit integer, so combine the two halves.
+        bits  = NULL;
+        high  = PyLong_FromUnsignedLongLong((unsigned long long)(value128 >> 64));
+        low   = PyLong_FromUnsignedLongLong((unsigned long long)value128);
+        shift = PyLong_FromLong(64);
+        if (high != NULL && low != NULL && shift != NULL && (shifted = PyNumber_Lshift(high, shift)) != NULL) {
+            bits = PyNumber_Or(shifted, low);
+            Py_DECREF(shifted);
+        }
+        Py_XDECREF(shift);
+        Py_XDECREF(high);
+        Py_XDECREF(low);
+        if (bits == NULL) {
+            return -1;
+        }
+        *value = PyObject_CallFunction(parser->decode_decimal, "Oiiiii", bits, 128, 14, 113, 6176, 34);
+        Py_DECREF(bits);
+        return *value == NULL ? -1 : 0;
+
+    case YA_NODE_TYPE_LIST:
+        PyErr_SetString(PyExc_NotImplementedError, "List node should not exist in the file.");
+        return -1;
+
+    case YA_NODE_TYPE_COUNT:
+        PyErr_SetString(PyExc_NotImplementedError, "Count node should not exist in the file.");
+        return -1;
+
+    default:
+        PyErr_Format(parser->exception, "Unknown node type %i.", (int)ya_cursor_type(cursor));
+        return -1;
+    }
+}
+
+/** Create a Python node with its factory.
+ * @param parser    The Python objects used while parsing.
+ * @param cursor    The node.
+ * @returns         New reference to the node, or NULL on error.
+ */
+static PyObject *ya_py_create(const ya_py_parser_t *parser, const ya_cursor_t *cursor)
+{
+    PyObject    *name;
+    PyObject    *node_info;
+    PyObject    *factory;
+    PyObject    *value;
+    PyObject    *node;
+
+    if ((name = ya_py_name(ya_cursor_name(cursor))) == NULL) {
+        return NULL;
+    }
+    if ((node_info = ya_py_node_info(parser, cursor, name)) == NULL) {
+        Py_DECREF(name);
+        return NULL;
+    }
+
+    // Get the factory class for the node.
+    if ((factory = PyDict_GetItem(parser->factories, name)) == NULL) {
+        PyErr_Format(parser->exception, "Could not find factory for '%s' node", PyBytes_AS_STRING(name));
+        Py_DECREF(node_info);
+        Py_DECREF(name);
+        return NULL;
+    }
+    Py_DECREF(name);
+
+    if (ya_py_value(parser, cursor, &value) == -1) {
+        Py_DECREF(node_info);
+        return NULL;
+    }
+
+    if (value != NULL) {
+        node = PyObject_CallFunctionObjArgs(factory, parser->symbol_table, node_info, value, NULL);
+        Py_DECREF(value);
+    } else {
+        node = PyObject_CallFunctionObjArgs(factory, parser->symbol_table, node_info, NULL);
+    }
+    Py_DECREF(node_info);
+    return node;
+}
+
+/** Finish a node, and add it to its parent.
+ * The reference to the node is stolen.
+ *
+ * @param stack     The branches of which the children are being parsed.
+ * @param node      The node that is finished.
+ * @param root      Set to the node when it has no parent.
+ * @returns         0 on success, -1 on error with a Python exception set.
+ */
+static int ya_py_finish(ya_py_stack_t *stack, PyObject *node, PyObject **root)
+{
+    PyObject    *r;
+
+    if ((r = PyObject_CallMethodObjArgs(node, ya_py_parsing_done, NULL)) == NULL) {
+        Py_DECREF(node);
+        return -1;
+    }
+    Py_DECREF(r);
+
+    if (stack->depth == 0) {
+        *root = node;
+        return 0;
+    }
+
+    r = PyObject_CallMethodObjArgs(stack->nodes[stack->depth - 1], ya_py_add_child, node, NULL);
+    Py_DECREF(node);
+    if (r == NULL) {
+        return -1;
+    }
+    Py_DECREF(r);
+    return 0;
+}
+
+/** Push a branch on the stack, the reference to the node is stolen.
+ * @returns         0 on success, -1 on error with a Python exception set.
+ */
+static int ya_py_push(ya_py_stack_t *stack, PyObject *node)
+{
+    PyObject    **nodes;
+    size_t      capacity;
+
+    if (stack->depth == stack->capacity) {
+        capacity = stack->capacity > 0 ? stack->capacity * 2 : 64;
+        if ((nodes = PyMem_Realloc(stack->nodes, capacity * sizeof (PyObject *))) == NULL) {
+            Py_DECREF(node);
+            PyErr_NoMemory();
+            return -1;
+        }
+        stack->nodes    = nodes;
+        stack->capacity = capacity;
+    }
+    stack->nodes[stack->depth++] = node;
+    return 0;
+}
+
+/** Finish the branches on the stack down to a level.
+ * @param stack     The branches of which the children are being parsed.
+ * @param level     The number of branches to keep on the stack.
+ * @param root      Set to the root node when it is finished.
+ * @returns         0 on success, -1 on error with a Python exception set.
+ */
+static int ya_py_pop(ya_py_stack_t *stack, size_t level, PyObject **root)
+{
+    while (stack->depth > level) {
+        stack->depth--;
+        if (ya_py_finish(stack, stack->nodes[stack->depth], root) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+PyDoc_STRVAR(ya_py_parse_doc,
+"parse(data, offset, end, symbol_table, factories, node_info, decode_decimal, exception)\n\n"
+"Parse the node which fills the data from offset to end, and return it as created by the factories.\n"
+"The nodes are visited in the same order as Parser.parse_node(), but without recursion.");
+
+static PyObject *ya_py_parse(PyObject *self, PyObject *args)
+{
+    ya_py_parser_t  parser;
+    ya_py_stack_t   stack = { NULL, 0, 0 };
+    Py_buffer       view;
+    Py_ssize_t      offset;
+    Py_ssize_t      end;
+    ya_reader_t     reader;
+    ya_cursor_t     root_cursor;
+    ya_cursor_t     cursor;
+    ya_walker_t     walker;
+    size_t          level;
+    PyObject        *root = NULL;
+    PyObject        *node;
+    int             r;
+
+    if (!PyArg_ParseTuple(args, YA_PY_BUFFER_FORMAT,
+        &view, &offset, &end, &parser.symbol_table, &parser.factories, &parser.node_info, &parser.decode_decimal, &parser.exception)) {
+        return NULL;
+    }
+    if (!PyDict_Check(parser.factories)) {
+        PyErr_SetString(PyExc_TypeError, "factories must be a dictionary.");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    if (offset < 0 || offset > end || end > view.len) {
+        PyErr_SetString(PyExc_ValueError, "The node must be located inside the data.");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    if (ya_reader_init(&reader, (const char *)view.buf + offset, end - offset) == -1) {
+        PyErr_SetString(PyExc_ValueError, "Data must be aligned to 64 bit.");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    if (ya_reader_root(&reader, &root_cursor) != 1) {
+        PyErr_SetString(parser.exception, "Root node does not fit in the file.");
+        goto error;
+    }
+    if (ya_cursor_data_size(&root_cursor) + sizeof (ya_node_t) != (size_t)(end - offset)) {
+        PyErr_SetString(parser.exception, "More data at end of file");
+        goto error;
+    }
+    if (ya_walker_init(&walker, &root_cursor) == -1) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    while ((r = ya_walker_next(&walker, &cursor, &level)) == 1) {
+        // The branches which are not a parent of this node have no more children.
+        if (ya_py_pop(&stack, level, &root) == -1) {
+            break;
+        }
+
+        // The offset index is only needed for random access, it is not part of the tree.
+        if (ya_cursor_type(&cursor) == YA_NODE_TYPE_INDEX) {
+            continue;
+        }
+
+        if ((node = ya_py_create(&parser, &cursor)) == NULL) {
+            break;
+        }
+        if (ya_cursor_type(&cursor) == YA_NODE_TYPE_BRANCH) {
+            if (ya_py_push(&stack, node) == -1) {
+                break;
+            }
+        } else if (ya_py_finish(&stack, node, &root) == -1) {
+            break;
+        }
+    }
+    ya_walker_free(&walker);
+
+    if (r == -1) {
+        PyErr_SetString(parser.exception, "Node does not fit in its parent.");
+        goto error;
+    } else if (r == 1 || ya_py_pop(&stack, 0, &root) == -1) {
+        goto error;
+    }
+
+    PyMem_Free(stack.nodes);
+    ya_reader_close(&reader);
+    PyBuffer_Release(&view);
+    if (root == NULL) {
+        Py_RETURN_NONE;
+    }
+    return root;
+
+error:
+    while (stack.depth > 0) {
+        Py_DECREF(stack.nodes[--stack.depth]);
+    }
+    Py_XDECREF(root);
+    PyMem_Free(stack.nodes);
+    ya_reader_close(&reader);
+    PyBuffer_Release(&view);
+    return NULL;
+}
+
+static PyMethodDef ya_py_methods[] = {
+    {"parse", ya_py_parse, METH_VARARGS, ya_py_parse_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+PyDoc_STRVAR(ya_py_module_doc,
+"Native parser for yyast files, used by Parser when it is available.");
+
+/** Intern the method names which are called for each node.
+ * @returns         0 on success, -1 on error with a Python exception set.
+ */
+static int ya_py_intern(void)
+{
+#if PY_MAJOR_VERSION >= 3
+    ya_py_parsing_done = PyUnicode_InternFromString("parsing_done");
+    ya_py_add_child    = PyUnicode_InternFromString("add_child");
+#else
+    ya_py_parsing_done = PyString_InternFromString("parsing_done");
+    ya_py_add_child    = PyString_InternFromString("add_child");
+#endif
+    return ya_py_parsing_done != NULL && ya_py_add_child != NULL ? 0 : -1;
+}
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef ya_py_module = {
+    PyModuleDef_HEAD_INIT, "_yyast", ya_py_module_doc, -1, ya_py_methods, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__yyast(void)
+{
+    if (ya_py_intern() == -1) {
+        return NULL;
+    }
+    return PyModule_Create(&ya_py_module);
+}
+#else
+PyMODINIT_FUNC init_yyast(void)
+{
+    if (ya_py_intern() == -1) {
+        return;
+    }
+    Py_InitModule3("_yyast", ya_py_methods, ya_py_module_doc);
+}
+#endif
@@ -24,15 +24,80 @@
 import yyast
 import mmap
 import struct
+import decimal
 from NodeInfo import NodeInfo
+from LazyNode import LazyNode
+
+try:
+    # The native parser is optional, it is only built when the Python headers were found.
+    import _yyast
+except ImportError:
+    _yyast = None
+
+# The methods of the Parser which the native parser implements in C.
+NATIVE_METHODS = (
+    "default_subparsers",
+    "default_decoders",
+    "parse_node_info",
+    "parse_node",
+    "find_factory",
+    "find_subparser",
+    "parse_null_node",
+    "parse_leaf_node",
+    "parse_branch_node",
+    "parse_text_node",
+    "parse_positive_integer_node",
+    "parse_negative_integer_node",
+    "parse_binary_float_node",
+    "parse_decimal_float_node",
+    "parse_list_node",
+    "parse_count_node",
+    "decode_null_value",
+    "decode_leaf_value",
+    "decode_text_value",
+    "decode_positive_integer_value",
+    "decode_negative_integer_value",
+    "decode_binary_float_value",
+    "decode_decimal_float_value",
+    "decode_list_value",
+    "decode_count_value",
+)
+
+def function_of(method):
+    """The plain function of a method, Python 2 wraps the functions of a class in unbound methods.
+    """
+    return getattr(method, "__func__", method)
 
 def strip_null(x):
     """Strip null bytes at the end of a string that is located in memory.
     """
-    for i in range(len(x) -1, -1, -1):
-        if x[i] != '\0':
-            break
-    return x[0:i+1]
+    return bytes(x).rstrip(b"\0")
+
+def decode_decimal(bits, nr_bits, exponent_bits, coefficient_bits, bias, nr_digits):
+    """Decode an IEEE-754 decimal64 or decimal128 in the binary integer decimal encoding.
+
+    The coefficient and exponent are kept as encoded, so 150e-2 is decoded as Decimal("1.50").
+    """
+    sign = (bits >> (nr_bits - 1)) & 1
+    combination = (bits >> (nr_bits - 6)) & 0x1f
+    if combination == 0x1f:
+        return decimal.Decimal("NaN")
+    elif combination == 0x1e:
+        return decimal.Decimal("-Infinity" if sign else "Infinity")
+
+    if (bits >> (nr_bits - 3)) & 3 == 3:
+        # Large coefficients have an implicit 0b100 prefix.
+        exponent = (bits >> (coefficient_bits - 2)) & ((1 << exponent_bits) - 1)
+        coefficient = (bits & ((1 << (coefficient_bits - 2)) - 1)) | (1 << coefficient_bits)
+    else:
+        exponent = (bits >> coefficient_bits) & ((1 << exponent_bits) - 1)
+        coefficient = bits & ((1 << coefficient_bits) - 1)
+
+    if coefficient >= 10 ** nr_digits:
+        # Non-canonical coefficients are interpreted as zero.
+        coefficient = 0
+
+    return decimal.Decimal((sign, tuple(int(digit) for digit in str(coefficient)), exponent - bias))
 
 class YYASTParserException (Exception):
     def __init__(self, *args):
@@ -41,7 +106,20 @@ class YYASTParserException (Exception):
 class Parser (object):
     def __init__(self):
         self.factories = {}
-        self.subparsers = {
+        self.flags = 0
+
+        # The native parser walks the file in C and only calls back for the factories. It is not used when
+        # the subparsers or decoders are overridden, see use_native(). Set to False to always parse in Python.
+        self.native = _yyast is not None
+        self.subparsers = self.default_subparsers()
+
+        # The values of nodes which are not branches.
+        self.decoders = self.default_decoders()
+
+    def default_subparsers(self):
+        """The subparser for each type of node.
+        """
+        return {
             yyast.NODE_TYPE_NULL:               self.parse_null_node,
             yyast.NODE_TYPE_LEAF:               self.parse_leaf_node,
             yyast.NODE_TYPE_BRANCH:             self.parse_branch_node,
@@ -54,6 +132,37 @@ class Parser (object):
             yyast.NODE_TYPE_COUNT:              self.parse_count_node,
         }
 
+    def default_decoders(self):
+        """The decoder of the value for each type of node which is not a branch.
+        """
+        return {
+            yyast.NODE_TYPE_NULL:               self.decode_null_value,
+            yyast.NODE_TYPE_LEAF:               self.decode_leaf_value,
+            yyast.NODE_TYPE_TEXT:               self.decode_text_value,
+            yyast.NODE_TYPE_POSITIVE_INTEGER:   self.decode_positive_integer_value,
+            yyast.NODE_TYPE_NEGATIVE_INTEGER:   self.decode_negative_integer_value,
+            yyast.NODE_TYPE_BINARY_FLOAT:       self.decode_binary_float_value,
+            yyast.NODE_TYPE_DECIMAL_FLOAT:      self.decode_decimal_float_value,
+            yyast.NODE_TYPE_LIST:               self.decode_list_value,
+            yyast.NODE_TYPE_COUNT:              self.decode_count_value,
+        }
+
+    def use_native(self):
+        """Check if the native parser can be used.
+
+        The native parser implements the subparsers and decoders of Parser in C. It is not used when a subclass
+        overrides one of them, or when an entry of self.subparsers or self.decoders was replaced.
+        """
+        if not self.native:
+            return False
+
+        cls = type(self)
+        for name in NATIVE_METHODS:
+            if function_of(getattr(cls, name)) is not function_of(getattr(Parser, name)):
+                return False
+
+        return self.subparsers == self.default_subparsers() and self.decoders == self.default_decoders()
+
     def register_factory(self, node_name, factory):
         """Register a class for parsing a node.
 
@@ -62,88 +171,128 @@ class Parser (object):
         """
         self.factories[node_name] = factory
 
-    def parse_null_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) > 0:
+    def decode_null_value(self, data, offset, end):
+        if end > offset:
             raise YYASTParserException("Null node should not have data.")
+        return None
+
+    def decode_leaf_value(self, data, offset, end):
+        if end > offset:
+            raise YYASTParserException("Leaf node should not have data.")
+        return None
+
+    def decode_text_value(self, data, offset, end):
+        return strip_null(data[offset:end]).decode("UTF-8")
+
+    def decode_positive_integer_value(self, data, offset, end):
+        if end - offset != 8:
+            raise YYASTParserException("Positive integer node should be exactly 64 bit.")
+
+        (value,) = struct.unpack_from(">Q", data, offset)
+        return value
+
+    def decode_negative_integer_value(self, data, offset, end):
+        if end - offset != 8:
+            raise YYASTParserException("Negative integer node should be exactly 64 bit.")
+
+        (value,) = struct.unpack_from(">Q", data, offset)
+        return -value
+
+    def decode_binary_float_value(self, data, offset, end):
+        if end - offset != 8:
+            raise YYASTParserException("Binary float node should be exactly 64 bit.")
+
+        (value,) = struct.unpack_from(">d", data, offset)
+        return value
+
+    def decode_decimal_float_value(self, data, offset, end):
+        if end - offset == 8:
+            (bits,) = struct.unpack_from(">Q", data, offset)
+            return decode_decimal(bits, 64, 10, 53, 398, 16)
+        elif end - offset == 16:
+            (high, low) = struct.unpack_from(">QQ", data, offset)
+            return decode_decimal((high << 64) | low, 128, 14, 113, 6176, 34)
+        else:
+            raise YYASTParserException("Decimal float node should be exactly 64 or 128 bit.")
+
+    def decode_list_value(self, data, offset, end):
+        raise NotImplementedError("List node should not exist in the file.")
+
+    def decode_count_value(self, data, offset, end):
+        raise NotImplementedError("Count node should not exist in the file.")
 
+    def parse_null_node(self, factory, symbol_table, node_info, data, offset, end):
+        self.decode_null_value(data, offset, end)
         node = factory(symbol_table, node_info)
         node.parsing_done()
         return node
 
-    def parse_leaf_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) > 0:
-            raise YYASTParserException("Leaf node should not have data.")
-
+    def parse_leaf_node(self, factory, symbol_table, node_info, data, offset, end):
+        self.decode_leaf_value(data, offset, end)
         node = factory(symbol_table, node_info)
         node.parsing_done()
         return node
 
-    def parse_branch_node(self, factory, symbol_table, node_info, internal_data):
+    def parse_branch_node(self, factory, symbol_table, node_info, data, offset, end):
         node = factory(symbol_table, node_info)
 
         # Parse the child nodes and add it to the node.
-        while internal_data:
-            child_node, internal_data = self.parse_node(symbol_table, internal_data)
-            node.add_child(child_node)
-      
-        node.parsing_done()   
+        while offset < end:
+            child_node, offset = self.parse_node(symbol_table, data, offset, end)
+            if child_node is not None:
+                node.add_child(child_node)
+
+        node.parsing_done()
         return node
 
-    def parse_text_node(self, factory, symbol_table, node_info, internal_data):
-        internal_data = strip_null(internal_data)
-        value = internal_data.decode("UTF-8")
+    def parse_text_node(self, factory, symbol_table, node_info, data, offset, end):
+        value = self.decode_text_value(data, offset, end)
         node = factory(symbol_table, node_info, value)
         node.parsing_done()
         return node
 
-    def parse_positive_integer_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) != 8:
-            raise YYASTParserException("Positive integer node should be exactly 64 bit.")
-
-        (value,) = struct.unpack(">Q", internal_data)
+    def parse_positive_integer_node(self, factory, symbol_table, node_info, data, offset, end):
+        value = self.decode_positive_integer_value(data, offset, end)
         node = factory(symbol_table, node_info, value)
         node.parsing_done()
         return node
 
-    def parse_negative_integer_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) != 8:
-            raise YYASTParserException("Negative integer node should be exactly 64 bit.")
-
-        (value,) = struct.unpack(">Q", internal_data)
-        node = factory(symbol_table, node_info, -value)
+    def parse_negative_integer_node(self, factory, symbol_table, node_info, data, offset, end):
+        value = self.decode_negative_integer_value(data, offset, end)
+        node = factory(symbol_table, node_info, value)
         node.parsing_done()
         return node
 
-    def parse_binary_float_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) != 8:
-            raise YYASTParserException("Binary float node should be exactly 64 bit.")
-
-        (value,) = struct.unpack(">d", internal_data)
+    def parse_binary_float_node(self, factory, symbol_table, node_info, data, offset, end):
+        value = self.decode_binary_float_value(data, offset, end)
         node = factory(symbol_table, node_info, value)
         node.parsing_done()
         return node
 
-    def parse_decimal_float_node(self, factory, symbol_table, node_info, internal_data):
-        if len(internal_data) != 8:
-            raise YYASTParserException("Decimal float node should not have data.")
-
-        raise NotImplementedError("Decimal float is not implemented in the parser.")
-
-    def parse_list_node(self, factory, symbol_table, node_info, internal_data):
-        raise NotImplementedError("List node should not exist in the file.")
+    def parse_decimal_float_node(self, factory, symbol_table, node_info, data, offset, end):
+        value = self.decode_decimal_float_value(data, offset, end)
+        node = factory(symbol_table, node_info, value)
+        node.parsing_done()
+        return node
 
-    def parse_count_node(self, factory, symbol_table, node_info, internal_data):
-        raise NotImplementedError("Count node should not exist in the file.")
+    def parse_list_node(self, factory, symbol_table, node_info, data, offset, end):
+        self.decode_list_value(data, offset, end)
 
-    def parse_node(self, symbol_table, data):
-        """Parse a single node from the data
+    def parse_count_node(self, factory, symbol_table, node_info, data, offset, end):
+        self.decode_count_value(data, offset, end)
 
-        This function will parse the data and recursively create and return nodes.
+    def parse_node_info(self, data, offset, end):
+        """Parse the header of a node from the data.
 
-        @param data Data from a yyast file.
-        @return node, rest  The parsed node, the rest data that is left after parsing the node.
+        @param data     Data from a yyast file.
+        @param offset   Offset of the node in the data.
+        @param end      End of the data of the parent node, the node must fit before it.
+        @return node_info, next_offset  The header of the node, the offset of the data after the node.
         """
 
+        if end - offset < 32:
+            raise YYASTParserException("Node header at offset %i is truncated." % offset)
+
         # Parse the header of the data.
         (
             node_name,
@@ -151,16 +300,13 @@ class Parser (object):
             line_nr,
             column_nr,
             file_nr,
-            reserved1,
+            flags,
             reserved2,
             node_type
-        ) = struct.unpack(">8sQLLLHBB", data[:32])
+        ) = struct.unpack_from(">8sQLLLHBB", data, offset)
 
-        # The internal data for the node starts from the header, until the length of the node data.
-        internal_data = data[32:node_size]
-
-        # The rest of the data after the node.
-        rest_data = data[node_size:]
+        if node_size < 32 or node_size > end - offset:
+            raise YYASTParserException("Node at offset %i does not fit in its parent." % offset)
 
         # Convert fields into more usable values.
         if line_nr   == 0xffffffff: line_nr   = None
@@ -176,28 +322,162 @@ class Parser (object):
             column_nr=column_nr,
             file_nr=file_nr
         )
+        return node_info, offset + node_size
+
+    def parse_node(self, symbol_table, data, offset, end):
+        """Parse a single node from the data
+
+        This function will parse the data and recursively create and return nodes.
+        The data is not copied, the nodes are read in place by their offset.
 
-        # Get the factory class for the node.
+        @param data     Data from a yyast file.
+        @param offset   Offset of the node in the data.
+        @param end      End of the data of the parent node, the node must fit before it.
+        @return node, next_offset  The parsed node, the offset of the data after the node.
+        """
+
+        node_info, next_offset = self.parse_node_info(data, offset, end)
+
+        # The offset index is only needed for random access, it is not part of the tree.
+        if node_info.node_type == yyast.NODE_TYPE_INDEX:
+            return None, next_offset
+
+        factory = self.find_factory(node_info)
+        subparser = self.find_subparser(node_info)
+        node = subparser(factory, symbol_table, node_info, data, offset + 32, next_offset)
+        return node, next_offset
+
+    def find_factory(self, node_info):
+        """Get the factory class for a node.
+        """
         try:
-            factory = self.factories[node_name]
+            return self.factories[node_info.node_name]
         except KeyError:
-            raise YYASTParserException("Could not find factory for '%s' node" % node_name)
+            raise YYASTParserException("Could not find factory for '%s' node" % node_info.node_name)
 
+    def find_subparser(self, node_info):
+        """Get the subparser for the type of a node.
+        """
         try:
-            subparser = self.subparsers[node_type]
+            return self.subparsers[node_info.node_type]
         except KeyError:
-            raise YYASTParserException("Unknown node type %i." % node_type)
-        
-        node = subparser(factory, symbol_table, node_info, internal_data)
-        return node, rest_data
+            raise YYASTParserException("Unknown node type %i." % node_info.node_type)
 
+    def parse_data(self, symbol_table, data, offset, end):
+        """Parse a node and its children, which fill the data from offset to end.
 
-    def parse(self, symbol_table, fd):
-        mapped_buffer = mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ)
-        node, rest_data = self.parse_node(symbol_table, mapped_buffer)
+        @param data     Data from a yyast file.
+        @param offset   Offset of the node in the data.
+        @param end      End of the node.
+        @return         The parsed node.
+        """
+        if self.use_native():
+            return _yyast.parse(data, offset, end, symbol_table, self.factories, NodeInfo, decode_decimal, YYASTParserException)
 
-        if len(rest_data) != 0:
+        node, next_offset = self.parse_node(symbol_table, data, offset, end)
+
+        if next_offset != end:
             raise YYASTParserException("More data at end of file")
 
         return node
 
+    def map(self, fd):
+        """Map a yyast file in memory.
+
+        @param fd       The file to map.
+        @return         The data of the file, which is read in place.
+        """
+        mapped_buffer = mmap.mmap(fd.fileno(), 0, access=mmap.ACCESS_READ)
+
+        try:
+            data = memoryview(mapped_buffer)
+        except TypeError:
+            # Python 2 can not make a memoryview of a mmap, but struct.unpack_from() reads it in place as well.
+            data = mapped_buffer
+
+        # The flags of the file are in the header of the root node.
+        (self.flags,) = struct.unpack_from(">H", data, 28)
+        return data
+
+    def parse(self, symbol_table, fd):
+        data = self.map(fd)
+        return self.parse_data(symbol_table, data, 0, len(data))
+
+    def parse_lazy(self, symbol_table, fd):
+        """Parse a file on demand.
+
+        Only the root is returned, the headers and children of nodes are parsed when they are accessed,
+        and the factories are called for a node and its children when LazyNode.node is first accessed.
+        Each factory is called once for each node, also when both a node and its parent are accessed.
+
+        @return         The root of the file as a LazyNode.
+        """
+        data = self.map(fd)
+        root = LazyNode(self, symbol_table, data, 0, len(data))
+
+        if root.node_info.node_size != len(data):
+            raise YYASTParserException("More data at end of file")
+
+        return root
+
+    def parse_events(self, fd):
+        """Parse a file as a stream of events, without calling the factories.
+
+        The nodes are visited depth first, using a stack of the open branches instead of recursion,
+        so that any depth of nesting can be parsed. Memory only grows with the depth of the tree, and
+        the parsing stops when the caller stops iterating.
+
+        @return         A generator of (event, node_info, value) tuples. The event is EVENT_ENTER_NODE
+                        and EVENT_EXIT_NODE around the children of a branch, and EVENT_LEAF_VALUE for
+                        other nodes. The value is None, except for EVENT_LEAF_VALUE of a literal.
+        """
+        data = self.map(fd)
+        end = len(data)
+
+        node_info, next_offset = self.parse_node_info(data, 0, end)
+        if next_offset != end:
+            raise YYASTParserException("More data at end of file")
+
+        return self.iterate_events(data, 0, end)
+
+    def iterate_events(self, data, offset, end):
+        """Generate the events for the nodes in the data from offset to end.
+
+        @param data     Data from a yyast file.
+        @param offset   Offset of the first node in the data.
+        @param end      End of the nodes.
+        """
+
+        # The node_info and end offset of each open branch.
+        stack = []
+
+        while True:
+            # The branches which have no more children are done.
+            while stack and offset == stack[-1][1]:
+                node_info, _ = stack.pop()
+                yield yyast.EVENT_EXIT_NODE, node_info, None
+
+            parent_end = stack[-1][1] if stack else end
+            if offset == parent_end:
+                return
+
+            node_info, next_offset = self.parse_node_info(data, offset, parent_end)
+
+            if node_info.node_type == yyast.NODE_TYPE_BRANCH:
+                yield yyast.EVENT_ENTER_NODE, node_info, None
+                stack.append((node_info, next_offset))
+                offset += 32
+
+            elif node_info.node_type == yyast.NODE_TYPE_INDEX:
+                # The offset index is only needed for random access, it is not part of the tree.
+                offset = next_offset
+
+            else:
+                try:
+                    decoder = self.decoders[node_info.node_type]
+                except KeyError:
+                    raise YYASTParserException("Unknown node type %i." % node_info.node_type)
+
+                yield yyast.EVENT_LEAF_VALUE, node_info, decoder(data, offset + 32, next_offset)
+                offset = next_offset
+
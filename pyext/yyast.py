@@ -31,7 +31,16 @@ NODE_TYPE_POSITIVE_INTEGER  = 4
 NODE_TYPE_NEGATIVE_INTEGER  = 5
 NODE_TYPE_BINARY_FLOAT      = 6
 NODE_TYPE_DECIMAL_FLOAT     = 7
+NODE_TYPE_INDEX             = 8     # Offset index, only as the last child of the root node.
+NODE_TYPE_SPOOL             = 253   # Never encoded in stream.
 NODE_TYPE_LIST              = 254   # Never encoded in stream.
 NODE_TYPE_COUNT             = 255   # Never encoded in stream.
 
+HEADER_FLAG_UTF8            = 0x0001    # All text nodes are valid UTF-8, only in the root node.
+HEADER_FLAG_INDEX           = 0x0002    # The last child of the root node is an offset index.
 
+
+
+EVENT_ENTER_NODE            = 0     # A branch node starts, its children follow.
+EVENT_LEAF_VALUE            = 1     # A node that is not a branch, with its value.
+EVENT_EXIT_NODE             = 2     # All children of a branch node were visited.
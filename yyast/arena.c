@@ -0,0 +1,278 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <yyast/arena.h>
+#include <yyast/context.h>
+
+void *ya_malloc_alloc(void *context, size_t size)
+{
+    return malloc(size);
+}
+
+void *ya_malloc_realloc(void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    return realloc(ptr, new_size);
+}
+
+void ya_malloc_free(void *context, void *ptr, size_t size)
+{
+    free(ptr);
+}
+
+static const ya_allocator_t ya_malloc_allocator = {
+    .alloc   = ya_malloc_alloc,
+    .realloc = ya_malloc_realloc,
+    .free    = ya_malloc_free,
+    .context = NULL
+};
+
+void ya_set_allocator(const ya_allocator_t *allocator)
+{
+    ya_context->allocator = allocator != NULL ? *allocator : ya_malloc_allocator;
+}
+
+static inline void ya_alloc_stats_bytes(ya_alloc_stats_t *stats, int64_t delta)
+{
+    stats->bytes+= delta;
+    if (stats->bytes > stats->peak_bytes) {
+        stats->peak_bytes = stats->bytes;
+    }
+}
+
+void *ya_alloc(size_t size)
+{
+    ya_context_t    *context = ya_context;
+    void            *ptr;
+
+    if ((ptr = context->allocator.alloc(context->allocator.context, size)) == NULL) {
+        perror("Could not allocate node");
+        abort();
+    }
+
+    context->alloc_stats.nr_allocations++;
+    ya_alloc_stats_bytes(&context->alloc_stats, size);
+    return ptr;
+}
+
+void *ya_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    ya_context_t    *context = ya_context;
+
+    if (ptr == NULL) {
+        return ya_alloc(new_size);
+    }
+
+    if ((ptr = context->allocator.realloc(context->allocator.context, ptr, old_size, new_size)) == NULL) {
+        perror("Could not reallocate node");
+        abort();
+    }
+
+    context->alloc_stats.nr_reallocations++;
+    ya_alloc_stats_bytes(&context->alloc_stats, (int64_t)new_size - (int64_t)old_size);
+    return ptr;
+}
+
+void ya_dealloc(void *ptr, size_t size)
+{
+    ya_context_t    *context = ya_context;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    context->allocator.free(context->allocator.context, ptr, size);
+
+    context->alloc_stats.nr_frees++;
+    ya_alloc_stats_bytes(&context->alloc_stats, -(int64_t)size);
+}
+
+void ya_arena_init(ya_arena_t *arena, size_t chunk_size)
+{
+    arena->chunks      = NULL;
+    arena->free_chunks = NULL;
+    arena->chunk_size  = chunk_size > 0 ? chunk_size : YA_ARENA_CHUNK_SIZE;
+    arena->last        = NULL;
+}
+
+/** Get a chunk with at least size bytes, reusing a free chunk when possible.
+ */
+static ya_arena_chunk_t *ya_arena_chunk(ya_arena_t *arena, size_t size)
+{
+    ya_arena_chunk_t    **p;
+    ya_arena_chunk_t    *chunk;
+
+    for (p = &arena->free_chunks; *p != NULL; p = &(*p)->next) {
+        if ((*p)->size >= size) {
+            chunk = *p;
+            *p = chunk->next;
+            chunk->used = 0;
+            return chunk;
+        }
+    }
+
+    size = MAX(size, arena->chunk_size);
+    if ((chunk = malloc(sizeof (ya_arena_chunk_t) + size)) == NULL) {
+        perror("Could not allocate arena chunk");
+        abort();
+    }
+    chunk->size = size;
+    chunk->used = 0;
+
+    ya_alloc_stats.nr_chunks++;
+    ya_alloc_stats.arena_bytes+= size;
+    if (ya_alloc_stats.arena_bytes > ya_alloc_stats.peak_arena_bytes) {
+        ya_alloc_stats.peak_arena_bytes = ya_alloc_stats.arena_bytes;
+    }
+    return chunk;
+}
+
+void *ya_arena_alloc(ya_arena_t *arena, size_t size)
+{
+    ya_arena_chunk_t    *chunk = arena->chunks;
+    void                *ptr;
+
+    // Keep all allocations aligned, like malloc.
+    size = (size + 15) & ~(size_t)15;
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        chunk = ya_arena_chunk(arena, size);
+
+        if (arena->chunks != NULL && size > arena->chunk_size) {
+            // An oversized chunk is placed behind the current chunk, so that the
+            // remaining memory of the current chunk can still be used.
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+            chunk->used = size;
+            return chunk->data;
+        }
+
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    ptr = &chunk->data[chunk->used];
+    chunk->used+= size;
+    return arena->last = ptr;
+}
+
+void *ya_arena_realloc(ya_arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    ya_arena_chunk_t    *chunk = arena->chunks;
+    size_t              offset;
+    void                *new_ptr;
+
+    if (ptr != NULL && ptr == arena->last && chunk != NULL) {
+        offset = (char *)ptr - chunk->data;
+        if (offset < chunk->size && chunk->size - offset >= new_size) {
+            // The last allocation of the current chunk can grow in place.
+            chunk->used = offset + ((new_size + 15) & ~(size_t)15);
+            return ptr;
+        }
+    }
+
+    new_ptr = ya_arena_alloc(arena, new_size);
+    if (ptr != NULL) {
+        memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    }
+    return new_ptr;
+}
+
+void ya_arena_free(ya_arena_t *arena, void *ptr, size_t size)
+{
+    ya_arena_chunk_t    *chunk = arena->chunks;
+
+    if (ptr != NULL && ptr == arena->last) {
+        // Only the last allocation can be given back, all other memory is released by ya_arena_reset().
+        chunk->used = (char *)ptr - chunk->data;
+        arena->last = NULL;
+    }
+}
+
+void ya_arena_reset(ya_arena_t *arena)
+{
+    ya_arena_chunk_t    *chunk;
+
+    // Move all the chunks to the free list, without touching the allocations.
+    while ((chunk = arena->chunks) != NULL) {
+        arena->chunks = chunk->next;
+        chunk->next = arena->free_chunks;
+        arena->free_chunks = chunk;
+    }
+    arena->last = NULL;
+}
+
+void ya_arena_destroy(ya_arena_t *arena)
+{
+    ya_arena_chunk_t    *chunk;
+
+    ya_arena_reset(arena);
+    while ((chunk = arena->free_chunks) != NULL) {
+        arena->free_chunks = chunk->next;
+        ya_alloc_stats.arena_bytes-= chunk->size;
+        free(chunk);
+    }
+}
+
+static void *ya_arena_alloc_hook(void *context, size_t size)
+{
+    return ya_arena_alloc(context, size);
+}
+
+static void *ya_arena_realloc_hook(void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    return ya_arena_realloc(context, ptr, old_size, new_size);
+}
+
+static void ya_arena_free_hook(void *context, void *ptr, size_t size)
+{
+    ya_arena_free(context, ptr, size);
+}
+
+void ya_use_arena(ya_arena_t *arena)
+{
+    ya_allocator_t  allocator = {
+        .alloc   = ya_arena_alloc_hook,
+        .realloc = ya_arena_realloc_hook,
+        .free    = ya_arena_free_hook,
+        .context = arena
+    };
+
+    ya_set_allocator(arena != NULL ? &allocator : NULL);
+}
+
+void ya_print_alloc_stats(FILE *output_file)
+{
+    fprintf(output_file, "allocations:      %llu\n", (unsigned long long)ya_alloc_stats.nr_allocations);
+    fprintf(output_file, "reallocations:    %llu\n", (unsigned long long)ya_alloc_stats.nr_reallocations);
+    fprintf(output_file, "frees:            %llu\n", (unsigned long long)ya_alloc_stats.nr_frees);
+    fprintf(output_file, "peak bytes:       %llu\n", (unsigned long long)ya_alloc_stats.peak_bytes);
+    fprintf(output_file, "arena chunks:     %llu\n", (unsigned long long)ya_alloc_stats.nr_chunks);
+    fprintf(output_file, "peak arena bytes: %llu\n", (unsigned long long)ya_alloc_stats.peak_arena_bytes);
+}
+
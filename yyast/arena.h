@@ -0,0 +1,161 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_ARENA_H
+#define YA_ARENA_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <yyast/types.h>
+
+/** Default size of an arena chunk.
+ */
+#define YA_ARENA_CHUNK_SIZE (1024 * 1024)
+
+/** Hooks for allocating the memory of nodes.
+ * The size of the allocation is passed to realloc and free, so that
+ * an allocator does not need to remember it.
+ */
+typedef struct {
+    void *(*alloc)(void *context, size_t size);                                      ///< Allocate memory.
+    void *(*realloc)(void *context, void *ptr, size_t old_size, size_t new_size);    ///< Grow memory, the content must be kept.
+    void (*free)(void *context, void *ptr, size_t size);                             ///< Free memory.
+    void *context;                                                                   ///< Passed to each hook.
+} ya_allocator_t;
+
+/** A chunk of memory of an arena.
+ */
+typedef struct ya_arena_chunk_s {
+    struct ya_arena_chunk_s *next;      ///< Next chunk in the list.
+    size_t                  size;       ///< Number of bytes in data.
+    size_t                  used;       ///< Number of bytes allocated from data.
+    char                    data[] __attribute__((aligned(16)));    ///< The memory handed out by the arena.
+} ya_arena_chunk_t;
+
+/** Bump allocator.
+ * Memory is allocated sequentially from large chunks. Individual allocations are not free-ed,
+ * instead all memory is released at once by ya_arena_reset() or ya_arena_destroy().
+ */
+typedef struct {
+    ya_arena_chunk_t    *chunks;            ///< Chunks in use, the chunk being allocated from is first.
+    ya_arena_chunk_t    *free_chunks;       ///< Chunks that are kept for reuse after a reset.
+    size_t              chunk_size;         ///< Size of a new chunk.
+    void                *last;              ///< The last allocation, which can be grown in place.
+} ya_arena_t;
+
+/** Allocation statistics.
+ * These allow comparing the malloc path with the arena.
+ */
+typedef struct {
+    uint64_t    nr_allocations;     ///< Number of allocations.
+    uint64_t    nr_reallocations;   ///< Number of allocations that were grown.
+    uint64_t    nr_frees;           ///< Number of frees.
+    uint64_t    bytes;              ///< Number of bytes currently allocated.
+    uint64_t    peak_bytes;         ///< Highest number of bytes allocated at the same time.
+    uint64_t    nr_chunks;          ///< Number of chunks allocated by all arenas.
+    uint64_t    arena_bytes;        ///< Number of bytes in chunks of all arenas.
+    uint64_t    peak_arena_bytes;   ///< Highest number of bytes in chunks of all arenas.
+} ya_alloc_stats_t;
+
+/** Allocate memory with malloc(), the default allocator hook.
+ */
+void *ya_malloc_alloc(void *context, size_t size);
+
+/** Grow memory with realloc(), the default allocator hook.
+ */
+void *ya_malloc_realloc(void *context, void *ptr, size_t old_size, size_t new_size);
+
+/** Free memory with free(), the default allocator hook.
+ */
+void ya_malloc_free(void *context, void *ptr, size_t size);
+
+/** Set the allocator used by the node constructors.
+ *
+ * @param allocator     The allocator to use, or NULL to use malloc.
+ */
+void ya_set_allocator(const ya_allocator_t *allocator);
+
+/** Allocate memory for a node.
+ * @param size          Number of bytes.
+ * @returns             Memory aligned to 64 bit, not initialized.
+ */
+void *ya_alloc(size_t size);
+
+/** Grow memory of a node.
+ * @param ptr           Memory returned by ya_alloc(), or NULL.
+ * @param old_size      The size of the memory.
+ * @param new_size      The new size of the memory.
+ * @returns             Memory with the content of ptr.
+ */
+void *ya_realloc(void *ptr, size_t old_size, size_t new_size);
+
+/** Free memory of a node.
+ * @param ptr           Memory returned by ya_alloc(), or NULL.
+ * @param size          The size of the memory.
+ */
+void ya_dealloc(void *ptr, size_t size);
+
+/** Initialize an arena.
+ *
+ * @param arena         The arena to initialize.
+ * @param chunk_size    Size of each chunk, or zero for YA_ARENA_CHUNK_SIZE.
+ */
+void ya_arena_init(ya_arena_t *arena, size_t chunk_size);
+
+/** Allocate memory from an arena.
+ */
+void *ya_arena_alloc(ya_arena_t *arena, size_t size);
+
+/** Grow memory allocated from an arena.
+ * The last allocation is grown in place when it fits in its chunk.
+ */
+void *ya_arena_realloc(ya_arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+/** Free memory allocated from an arena.
+ * Only the last allocation is given back, other memory is kept until the arena is reset.
+ */
+void ya_arena_free(ya_arena_t *arena, void *ptr, size_t size);
+
+/** Release all memory allocated from the arena.
+ * The chunks are kept to be reused by the next allocations.
+ */
+void ya_arena_reset(ya_arena_t *arena);
+
+/** Release all memory of the arena, including the chunks.
+ */
+void ya_arena_destroy(ya_arena_t *arena);
+
+/** Use an arena for all node constructors.
+ *
+ * @param arena         The arena to allocate from, or NULL to use malloc.
+ */
+void ya_use_arena(ya_arena_t *arena);
+
+/** Print the allocation statistics.
+ */
+void ya_print_alloc_stats(FILE *output_file);
+
+#endif
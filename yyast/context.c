@@ -0,0 +1,83 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <yyast/context.h>
+#include <yyast/count.h>
+#include <yyast/leaf.h>
+#include <yyast/node.h>
+
+/** Initial value of a context.
+ */
+#define YA_CONTEXT_DEFAULTS {                           \
+    .previous_position  = {0, 0, 0},                    \
+    .current_position   = {0, 0, 0},                    \
+    .more_length        = 0,                            \
+    .filenames          = {NULL, NULL, 0, 0, NULL, 0},  \
+    .leaf_templates     = {NULL, 0, 0},                 \
+    .deferred           = 0,                            \
+    .validate_utf8      = 0,                            \
+    .write_index        = 0,                            \
+    .spool              = NULL,                         \
+    .spool_threshold    = YA_SPOOL_THRESHOLD,           \
+    .allocator          = {                             \
+        .alloc   = ya_malloc_alloc,                     \
+        .realloc = ya_malloc_realloc,                   \
+        .free    = ya_malloc_free,                      \
+        .context = NULL                                 \
+    },                                                  \
+    .input_filename     = NULL,                         \
+    .output_filename    = NULL,                         \
+    .error_jump         = NULL,                         \
+    .error_message      = NULL                          \
+}
+
+ya_context_t ya_default_context = YA_CONTEXT_DEFAULTS;
+
+__thread ya_context_t *ya_context = &ya_default_context;
+
+void ya_context_init(ya_context_t *context)
+{
+    ya_context_t defaults = YA_CONTEXT_DEFAULTS;
+
+    *context = defaults;
+}
+
+void ya_context_destroy(ya_context_t *context)
+{
+    ya_filenames_free(&context->filenames);
+    ya_leaf_templates_free(&context->leaf_templates);
+    free(context->error_message);
+    context->error_message = NULL;
+}
+
+ya_context_t *ya_context_switch(ya_context_t *context)
+{
+    ya_context_t *previous = ya_context;
+
+    ya_context = context != NULL ? context : &ya_default_context;
+    return previous;
+}
@@ -0,0 +1,110 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_CONTEXT_H
+#define YA_CONTEXT_H
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <yyast/types.h>
+#include <yyast/arena.h>
+
+/** State of a parse.
+ * All state which changes while parsing a file is kept in a context. Each thread
+ * has a current context, which is used by all the functions of the yyast API.
+ * Several files can be parsed at the same time by giving each thread its own context.
+ *
+ * The global names, like ya_current_position and ya_start, are macros which refer to
+ * the current context. Threads start with ya_default_context as their current context,
+ * so a program which parses a single file does not need to know about contexts.
+ */
+typedef struct {
+    ya_position_t       previous_position;  ///< Position of the start of the current token.
+    ya_position_t       current_position;   ///< Position of the end of the current token.
+    size_t              more_length;        ///< Number of bytes of the current token which were counted before yymore().
+    ya_filenames_t      filenames;          ///< Source filenames, which are written in the header.
+    ya_leaf_templates_t leaf_templates;     ///< Shared templates of leaves without data.
+    ya_t                start;              ///< The top node, set by the grammar with YA_HEADER.
+    int                 deferred;           ///< Defer serialization of branches until the tree is saved.
+    int                 validate_utf8;      ///< Validate that text literals are UTF-8.
+    int                 write_index;        ///< Write an offset index of the nodes in the root node.
+    FILE                *spool;             ///< Spool file for finished parts of large lists, or NULL.
+    size_t              spool_threshold;    ///< Number of bytes a list may hold in memory before it is spooled.
+    ya_allocator_t      allocator;          ///< Allocator used by the node constructors.
+    ya_alloc_stats_t    alloc_stats;        ///< Allocation statistics of the node constructors.
+    char                *input_filename;    ///< Name of the file being parsed.
+    char                *output_filename;   ///< Name of the file the AST is written to.
+    jmp_buf             *error_jump;        ///< When set, ya_error() jumps here instead of exiting the process.
+    char                *error_message;     ///< Message of the last ya_error(), when error_jump is set.
+} ya_context_t;
+
+/** The context used by threads which did not select their own.
+ */
+extern ya_context_t ya_default_context;
+
+/** The current context of this thread.
+ * Use ya_context_switch() to change it.
+ */
+extern __thread ya_context_t *ya_context;
+
+/** The top node, set by the grammar with YA_HEADER.
+ */
+#define ya_start                (ya_context->start)
+
+/** Allocation statistics of all node constructors.
+ */
+#define ya_alloc_stats          (ya_context->alloc_stats)
+
+/** Name of the file being parsed.
+ */
+#define ya_input_filename       (ya_context->input_filename)
+
+/** Name of the file the AST is written to.
+ */
+#define ya_output_filename      (ya_context->output_filename)
+
+/** Initialize a context for a new parse.
+ * The context uses malloc for nodes, and is not deferred or streaming.
+ *
+ * @param context   The context to initialize.
+ */
+void ya_context_init(ya_context_t *context);
+
+/** Release the memory of a context.
+ * The nodes of the tree are not released, use ya_node_free() or an arena for those.
+ * The error message is released.
+ * The spool file is not closed.
+ *
+ * @param context   The context to destroy.
+ */
+void ya_context_destroy(ya_context_t *context);
+
+/** Select the current context of this thread.
+ *
+ * @param context   The context to use, or NULL for ya_default_context.
+ * @returns         The previous context of this thread.
+ */
+ya_context_t *ya_context_switch(ya_context_t *context);
+
+#endif
@@ -31,49 +31,199 @@
 #include <yyast/count.h>
 #include <yyast/utils.h>
 
-ya_position_t ya_previous_position = {0, 0, 0};
-ya_position_t ya_current_position = {0, 0, 0};
+#ifdef YA_COUNT_X86
+#include <immintrin.h>
+#endif
 
-char *ya_filenames[YA_MAX_NR_FILENAMES];
-int ya_nr_filenames = 0;
-
-ya_t ya_count(char *s, size_t s_length)
+void ya_count_text_scalar(ya_position_t *position, const char *s, size_t s_length)
 {
-    uint32_t i;
+    size_t   i;
     char     c;
-    int      ascii;
     int      utf8_start;
     int      printable_ascii;
-    ya_t     r;
-
-    ya_previous_position = ya_current_position;
 
     // For the actual column and line we have to read the characters.
     for (i = 0; i < s_length; i++) {
         switch (c = s[i]) {
         case '\n': // Line feed goes to the next line and to the left.
-            ya_current_position.line++;
-            ya_current_position.column = 0;
+            position->line++;
+            position->column = 0;
             break;
         case '\r': // Carriage return only goes to the left.
-            ya_current_position.column = 0;
+            position->column = 0;
             break;
         case '\t': // Tab moves cursor to the right on the next 8 column boundary.
-            ya_current_position.column+= 8 - (ya_current_position.column % 8);
+            position->column+= 8 - (position->column % 8);
         default:
             printable_ascii = (c >= ' ') && (c <= '~');
             utf8_start = (c & 0xc0) == 0x80;
 
             if (printable_ascii || utf8_start) {
                 // Only increment column on ASCII and UTF-8 start marker.
-                ya_current_position.column++;
+                position->column++;
             }
         }
     }
+}
+
+#ifdef YA_COUNT_X86
+/** Count a block of characters, given as bit masks.
+ * Bit n of each mask is set when byte n of the block matches.
+ *
+ * @param position  The position to update.
+ * @param counted   Bytes which advance the column by one.
+ * @param lf        Line feeds.
+ * @param cr        Carriage returns.
+ * @param tab       Tabs.
+ */
+static inline void ya_count_masks(ya_position_t *position, uint32_t counted, uint32_t lf, uint32_t cr, uint32_t tab)
+{
+    uint32_t    special;
+    uint32_t    before;
+    uint32_t    bit;
+    uint32_t    after_lf;
+
+    if (lf) {
+        // Everything before the last line feed does not change the column.
+        position->line+= __builtin_popcount(lf);
+        position->column = 0;
+
+        after_lf = ~((2u << (31 - __builtin_clz(lf))) - 1);
+        counted&= after_lf;
+        cr&= after_lf;
+        tab&= after_lf;
+    }
+
+    // Carriage returns and tabs depend on the column, handle them in order.
+    for (special = cr | tab; special; special&= special - 1) {
+        bit = special & -special;
+        before = bit - 1;
+
+        position->column+= __builtin_popcount(counted & before);
+        counted&= ~before;
+
+        if (cr & bit) {
+            position->column = 0;
+        } else {
+            position->column+= 8 - (position->column % 8);
+        }
+    }
+
+    position->column+= __builtin_popcount(counted);
+}
+
+__attribute__((target("sse2")))
+void ya_count_text_sse2(ya_position_t *position, const char *s, size_t s_length)
+{
+    size_t      i;
+    __m128i     v;
+    __m128i     counted;
+
+    for (i = 0; i + 16 <= s_length; i+= 16) {
+        v = _mm_loadu_si128((const __m128i *)&s[i]);
+
+        // Printable ASCII ' ' to '~' and UTF-8 bytes 0x80 to 0xbf, compared as signed bytes.
+        counted = _mm_or_si128(
+            _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(' ' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('~' + 1))),
+            _mm_cmplt_epi8(v, _mm_set1_epi8((char)0xc0))
+        );
+
+        ya_count_masks(position,
+            _mm_movemask_epi8(counted),
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))),
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')))
+        );
+    }
+
+    ya_count_text_scalar(position, &s[i], s_length - i);
+}
+
+__attribute__((target("avx2")))
+void ya_count_text_avx2(ya_position_t *position, const char *s, size_t s_length)
+{
+    size_t      i;
+    __m256i     v;
+    __m256i     counted;
+
+    for (i = 0; i + 32 <= s_length; i+= 32) {
+        v = _mm256_loadu_si256((const __m256i *)&s[i]);
+
+        // Printable ASCII ' ' to '~' and UTF-8 bytes 0x80 to 0xbf, compared as signed bytes.
+        counted = _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(' ' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('~' + 1), v)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8((char)0xc0), v)
+        );
+
+        ya_count_masks(position,
+            _mm256_movemask_epi8(counted),
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))),
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')))
+        );
+    }
+
+    // Every CPU with AVX2 also has SSE2.
+    ya_count_text_sse2(position, &s[i], s_length - i);
+}
+#endif
+
+/** Select the fastest implementation the first time it is called.
+ * Parsers on different threads may race to select it, they all store the same function.
+ */
+static void ya_count_text_dispatch(ya_position_t *position, const char *s, size_t s_length);
+
+static void (*ya_count_text_implementation)(ya_position_t *position, const char *s, size_t s_length) = ya_count_text_dispatch;
+
+static void ya_count_text_dispatch(ya_position_t *position, const char *s, size_t s_length)
+{
+    void (*implementation)(ya_position_t *position, const char *s, size_t s_length);
+
+#ifdef YA_COUNT_X86
+    if (__builtin_cpu_supports("avx2")) {
+        implementation = ya_count_text_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        implementation = ya_count_text_sse2;
+    } else {
+        implementation = ya_count_text_scalar;
+    }
+#else
+    implementation = ya_count_text_scalar;
+#endif
+
+    __atomic_store_n(&ya_count_text_implementation, implementation, __ATOMIC_RELAXED);
+    implementation(position, s, s_length);
+}
+
+void ya_count_text(ya_position_t *position, const char *s, size_t s_length)
+{
+    if (s_length < 16) {
+        // Most tokens are short, the vector implementations only help on long tokens.
+        ya_count_text_scalar(position, s, s_length);
+    } else {
+        __atomic_load_n(&ya_count_text_implementation, __ATOMIC_RELAXED)(position, s, s_length);
+    }
+}
+
+ya_t ya_count(char *s, size_t s_length)
+{
+    ya_t     r;
+
+    if (ya_more_length > 0) {
+        // The start of the token was counted before yymore(), the previous position is still its start.
+        ya_count_text(&ya_current_position, &s[ya_more_length], s_length - ya_more_length);
+        ya_more_length = 0;
+    } else {
+        ya_previous_position = ya_current_position;
+        ya_count_text(&ya_current_position, s, s_length);
+    }
+
     r.size = 0;
     r.type = YA_NODE_TYPE_COUNT;
     r.position = ya_previous_position;
+    r.shared = 0;
     r.node = NULL;
+    r.tree = NULL;
     return r;
 }
 
@@ -92,34 +242,128 @@ void ya_reverse_count(char *s, size_t s_length)
     ya_current_position.column = 0;
 }
 
-uint32_t ya_get_file_nr(char *filename)
+void ya_more(size_t s_length)
 {
-    int i;
+    ya_more_length = s_length;
+}
 
-    for (i = 0; i < YA_MAX_NR_FILENAMES; i++) {
-        if (i < ya_nr_filenames) {
-            if (strcmp(ya_filenames[i], filename) == 0) {
-                // filename is found in the table, return the index in the table.
-                return i;
-            }
-            // filename is not found in this entry, try the next entry.
+/** FNV-1a hash of a filename.
+ */
+static inline uint32_t ya_filename_hash(const char *filename, size_t filename_length)
+{
+    uint64_t    hash = 0xcbf29ce484222325ULL;
+    size_t      i;
 
-        } else {
-            // Append the filename to the table.
-            ya_filenames[i] = strdup(filename);
-            ya_nr_filenames++;
-            return i;
+    for (i = 0; i < filename_length; i++) {
+        hash^= (uint8_t)filename[i];
+        hash*= 0x100000001b3ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+/** Find the slot in the hash table for a filename.
+ * @returns The slot holding the filename, or the empty slot where it should be added.
+ */
+static uint32_t ya_filename_slot(const char *filename, size_t filename_length)
+{
+    uint32_t    mask = ya_filenames.table_size - 1;
+    uint32_t    slot = ya_filename_hash(filename, filename_length) & mask;
+    uint32_t    file_nr;
+
+    while ((file_nr = ya_filenames.table[slot]) != UINT32_MAX) {
+        if (ya_filenames.lengths[file_nr] == filename_length && memcmp(ya_filenames.filenames[file_nr], filename, filename_length) == 0) {
+            break;
         }
+        slot = (slot + 1) & mask;
     }
+    return slot;
+}
 
-    // Filename could not be found and could not be added to the table.
-    return UINT32_MAX;
+/** Double the size of the hash table, keeping it at most half full.
+ */
+static int ya_filenames_grow_table(void)
+{
+    uint32_t    *old_table = ya_filenames.table;
+    uint32_t    table_size = ya_filenames.table_size > 0 ? ya_filenames.table_size * 2 : 64;
+    uint32_t    file_nr;
+
+    if ((ya_filenames.table = malloc(table_size * sizeof (uint32_t))) == NULL) {
+        ya_filenames.table = old_table;
+        return -1;
+    }
+    memset(ya_filenames.table, 0xff, table_size * sizeof (uint32_t));
+    ya_filenames.table_size = table_size;
+
+    for (file_nr = 0; file_nr < ya_filenames.nr_filenames; file_nr++) {
+        ya_filenames.table[ya_filename_slot(ya_filenames.filenames[file_nr], ya_filenames.lengths[file_nr])] = file_nr;
+    }
+    free(old_table);
+    return 0;
+}
+
+uint32_t ya_intern_filename(const char *filename, size_t filename_length)
+{
+    uint32_t    slot;
+    uint32_t    file_nr;
+    uint32_t    capacity;
+    char        **filenames;
+    size_t      *lengths;
+
+    if (ya_filenames.nr_filenames * 2 >= ya_filenames.table_size && ya_filenames_grow_table() == -1) {
+        return UINT32_MAX;
+    }
+
+    slot = ya_filename_slot(filename, filename_length);
+    if ((file_nr = ya_filenames.table[slot]) != UINT32_MAX) {
+        // filename is found in the table, return the index in the table.
+        return file_nr;
+    }
+
+    if (ya_filenames.nr_filenames == ya_filenames.capacity) {
+        capacity = ya_filenames.capacity > 0 ? ya_filenames.capacity * 2 : 16;
+        if ((filenames = realloc(ya_filenames.filenames, capacity * sizeof (char *))) == NULL) {
+            return UINT32_MAX;
+        }
+        ya_filenames.filenames = filenames;
+        if ((lengths = realloc(ya_filenames.lengths, capacity * sizeof (size_t))) == NULL) {
+            return UINT32_MAX;
+        }
+        ya_filenames.lengths = lengths;
+        ya_filenames.capacity = capacity;
+    }
+
+    // Append the filename to the table.
+    file_nr = ya_filenames.nr_filenames;
+    if ((ya_filenames.filenames[file_nr] = strndup(filename, filename_length)) == NULL) {
+        return UINT32_MAX;
+    }
+    ya_filenames.lengths[file_nr] = filename_length;
+    ya_filenames.table[slot] = file_nr;
+    ya_filenames.nr_filenames++;
+    return file_nr;
+}
+
+uint32_t ya_get_file_nr(char *filename)
+{
+    return ya_intern_filename(filename, strlen(filename));
+}
+
+void ya_filenames_free(ya_filenames_t *filenames)
+{
+    uint32_t    i;
+
+    for (i = 0; i < filenames->nr_filenames; i++) {
+        free(filenames->filenames[i]);
+    }
+    free(filenames->filenames);
+    free(filenames->lengths);
+    free(filenames->table);
+    memset(filenames, 0, sizeof (ya_filenames_t));
 }
 
 void ya_reposition(char *s, size_t s_length)
 {
     char    *s_filename;
-    char    *filename;
     long    line       = strtol(s, &s_filename, 10);
 
     ya_previous_position = ya_current_position;
@@ -134,21 +378,20 @@ void ya_reposition(char *s, size_t s_length)
 
     if (*s_filename == ' ') {
         // This will contain a filename. Skip of the space and the quote. Strip the trailing quote.
-        filename = strndup(&s_filename[2], s_length - (s_filename - s) - 3);
-
-        ya_current_position.file = ya_get_file_nr(filename);
+        ya_current_position.file = ya_intern_filename(&s_filename[2], s_length - (s_filename - s) - 3);
     }
 }
 
 ya_t ya_get_filenames(void)
 {
-    ya_t    filename;
-    ya_t    filename_list = YA_EMPTYLIST;
-    ya_t    filenames;
-    int     i;
+    ya_t        filename;
+    ya_t        filename_list = YA_EMPTYLIST;
+    ya_t        filenames;
+    uint32_t    i;
 
-    for (i = 0; i < ya_nr_filenames; i++) {
-        filename = ya_text("#file", ya_filenames[i], strlen(ya_filenames[i]));
+    for (i = 0; i < ya_filenames.nr_filenames; i++) {
+        // Filenames are not validated like text literals, they are checked by ya_header().
+        filename = ya_literal_checked("#file", YA_NODE_TYPE_TEXT, ya_filenames.filenames[i], ya_filenames.lengths[i], 0);
         ya_clear_position(&filename);
         filename_list = YA_LIST(&filename_list, &filename);
     }
@@ -163,8 +406,13 @@ void ya_clear_position(ya_t *node)
     node->position.column = UINT32_MAX;
     node->position.line = UINT32_MAX;
     node->position.file = UINT32_MAX;
-    node->node->position.column = UINT32_MAX;
-    node->node->position.line = UINT32_MAX;
-    node->node->position.file = UINT32_MAX;
+    if (node->node != NULL && !node->shared) {
+        node->node->position.column = UINT32_MAX;
+        node->node->position.line = UINT32_MAX;
+        node->node->position.file = UINT32_MAX;
+    }
+    if (node->tree != NULL) {
+        node->tree->position = node->position;
+    }
 }
 
@@ -26,19 +26,65 @@
 #define YA_COUNT_H
 
 #include <yyast/types.h>
+#include <yyast/context.h>
 
-/** Maximum number of source filenames being tracked.
+/** Position of the start of the current token.
  */
-#define YA_MAX_NR_FILENAMES 65536
+#define ya_previous_position    (ya_context->previous_position)
 
-extern ya_position_t ya_previous_position;
-extern ya_position_t ya_current_position;
+/** Position of the end of the current token.
+ */
+#define ya_current_position     (ya_context->current_position)
+
+/** Number of bytes at the start of the current token which were counted before yymore().
+ */
+#define ya_more_length          (ya_context->more_length)
+
+/** Source filenames, which are written in the header.
+ */
+#define ya_filenames            (ya_context->filenames)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/** SSE2 and AVX2 implementations of ya_count_text() are available.
+ */
+#define YA_COUNT_X86
+#endif
+
+/** Count characters of a text and advance a position.
+ * The columns are counted in the same way as ya_count().
+ * A vector implementation is selected at runtime for long texts.
+ *
+ * @param position  The position to advance.
+ * @param s         The string to analyze
+ * @param s_length  The length of the string in bytes.
+ */
+void ya_count_text(ya_position_t *position, const char *s, size_t s_length);
+
+/** Count characters of a text one byte at a time.
+ * See ya_count_text().
+ */
+void ya_count_text_scalar(ya_position_t *position, const char *s, size_t s_length);
+
+#ifdef YA_COUNT_X86
+/** Count characters of a text 16 bytes at a time.
+ * Only call this when the CPU supports SSE2. See ya_count_text().
+ */
+void ya_count_text_sse2(ya_position_t *position, const char *s, size_t s_length);
+
+/** Count characters of a text 32 bytes at a time.
+ * Only call this when the CPU supports AVX2. See ya_count_text().
+ */
+void ya_count_text_avx2(ya_position_t *position, const char *s, size_t s_length);
+#endif
 
 /** Count characters.
  * This functions keeps track of byte position, line and column.
  * The byte, line and columns are zero index.
  * This function works with UTF-8.
  *
+ * After ya_more() only the text appended to the token is counted, and the
+ * position of the node is the start of the whole token.
+ *
  * @param s         The string to analyze
  * @param s_length  The length of the string in bytes.
  * @returns         An initialized ya structure without a node.
@@ -47,9 +93,18 @@ ya_t ya_count(char *s, size_t s_length);
 
 /** Reverse count characters.
  * This is a replacement function for yy_more() which throws of our line counting.
+ * The column is lost, and the next ya_count() counts the whole token again; use ya_more() instead.
  */
 void ya_reverse_count(char *s, size_t s_length);
 
+/** Continue counting the current token after yymore().
+ * The next ya_count() only counts the text after the first s_length bytes, so that a token
+ * which is built from many fragments is counted in linear time, with exact columns.
+ *
+ * @param s_length  The length of the token so far, yyleng.
+ */
+void ya_more(size_t s_length);
+
 /** Get the file number of a filename.
  * Adds the filename to the table when it was not found.
  *
@@ -58,6 +113,15 @@ void ya_reverse_count(char *s, size_t s_length);
  */
 uint32_t ya_get_file_nr(char *filename);
 
+/** Get the file number of a filename which is not nul terminated.
+ * Adds a copy of the filename to the table when it was not found.
+ *
+ * @param filename          Filename to search in the source file list.
+ * @param filename_length   Number of bytes in the filename.
+ * @return                  The index of the filename in the source file list. Or UINT32_MAX if the table is full.
+ */
+uint32_t ya_intern_filename(const char *filename, size_t filename_length);
+
 /** Reposition.
  * The given string is a reposition command, it contains the line number of the next
  * line and optionally a filename.
@@ -67,6 +131,11 @@ uint32_t ya_get_file_nr(char *filename);
  */
 void ya_reposition(char *s, size_t s_length);
 
+/** Free the filenames of a registry.
+ * @param filenames The registry to free, it is left empty.
+ */
+void ya_filenames_free(ya_filenames_t *filenames);
+
 /** Get a list of filenames, as a node that is placed in the header.
  * @return A node with a list of filenames.
  */
@@ -79,8 +148,12 @@ void ya_clear_position(ya_t *node);
 
 /** Count columns and lines for each token found by lex.
  */
+#ifdef YA_REENTRANT
+#define YY_USER_ACTION        { *yylval = ya_count(yytext, yyleng); }
+#else
 #define YY_USER_ACTION        { yylval = ya_count(yytext, yyleng); }
+#endif
 
-#define YA_MORE               { ya_reverse_count(yytext, yyleng); yymore(); }
+#define YA_MORE               { ya_more(yyleng); yymore(); }
 
 #endif
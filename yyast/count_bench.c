@@ -0,0 +1,138 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <yyast/count.h>
+
+/** Size of the text to count.
+ */
+#define TEXT_SIZE       (64 * 1024 * 1024)
+
+/** Number of times the text is counted.
+ */
+#define NR_ITERATIONS   5
+
+typedef void (*count_function_t)(ya_position_t *position, const char *s, size_t s_length);
+
+/** Fill a buffer with text that looks like a large comment block.
+ * Lines of varying length with some tabs, carriage returns and UTF-8 characters.
+ */
+void fill_text(char *text, size_t text_size)
+{
+    static const char   *words[] = {"the ", "parser ", "\t", "counts ", "columns ", "\xc3\xa9t\xc3\xa9 ", "\xe2\x82\xac ", "* ", "\r\n", "\n"};
+    size_t              i = 0;
+    size_t              word_size;
+    const char          *word;
+
+    srand(42);
+    while (i < text_size) {
+        word = words[rand() % (sizeof (words) / sizeof (words[0]))];
+        word_size = MIN(strlen(word), text_size - i);
+        memcpy(&text[i], word, word_size);
+        i+= word_size;
+    }
+}
+
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Count the text in tokens of token_size bytes.
+ */
+ya_position_t count(count_function_t function, const char *text, size_t text_size, size_t token_size, double *seconds)
+{
+    ya_position_t   position = {0, 0, 0};
+    size_t          i;
+    int             iteration;
+    double          start = now();
+
+    for (iteration = 0; iteration < NR_ITERATIONS; iteration++) {
+        for (i = 0; i < text_size; i+= token_size) {
+            function(&position, &text[i], MIN(token_size, text_size - i));
+        }
+    }
+
+    *seconds = now() - start;
+    return position;
+}
+
+int main(int argc, char *argv[])
+{
+    static const size_t token_sizes[] = {16, 64, 1024, TEXT_SIZE};
+    struct {
+        const char          *name;
+        count_function_t    function;
+        int                 supported;
+    } implementations[] = {
+        {"scalar",  ya_count_text_scalar,   1},
+#ifdef YA_COUNT_X86
+        {"sse2",    ya_count_text_sse2,     __builtin_cpu_supports("sse2")},
+        {"avx2",    ya_count_text_avx2,     __builtin_cpu_supports("avx2")},
+#endif
+        {"default", ya_count_text,          1},
+    };
+    char            *text = malloc(TEXT_SIZE);
+    ya_position_t   expected;
+    ya_position_t   position;
+    double          seconds;
+    size_t          i;
+    size_t          j;
+    int             r = 0;
+
+    fill_text(text, TEXT_SIZE);
+
+    for (i = 0; i < sizeof (token_sizes) / sizeof (token_sizes[0]); i++) {
+        for (j = 0; j < sizeof (implementations) / sizeof (implementations[0]); j++) {
+            if (!implementations[j].supported) {
+                continue;
+            }
+
+            position = count(implementations[j].function, text, TEXT_SIZE, token_sizes[i], &seconds);
+            if (j == 0) {
+                expected = position;
+            } else if (memcmp(&position, &expected, sizeof (position)) != 0) {
+                fprintf(stderr, "%s: position %u:%u differs from scalar %u:%u\n",
+                    implementations[j].name, position.line, position.column, expected.line, expected.column
+                );
+                r = 1;
+            }
+
+            fprintf(stdout, "token size %9zu %-8s %8.1f MB/s\n",
+                token_sizes[i], implementations[j].name, (double)TEXT_SIZE * NR_ITERATIONS / seconds / 1e6
+            );
+        }
+    }
+
+    free(text);
+    return r;
+}
+
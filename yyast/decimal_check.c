@@ -0,0 +1,56 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <yyast/real.h>
+
+/** Convert each line of stdin to decimal64 and decimal128.
+ * For each literal a line is written with the status and bits in hexadecimal of both conversions,
+ * which decimal_check.py compares with the decimal module of Python.
+ */
+int main(int argc, char *argv[])
+{
+    char                line[4096];
+    size_t              length;
+    uint64_t            value64;
+    uint128_t           value128;
+    ya_real_status_t    status64;
+    ya_real_status_t    status128;
+
+    while (fgets(line, sizeof (line), stdin) != NULL) {
+        length = strcspn(line, "\n");
+        value64 = 0;
+        value128 = 0;
+        status64  = ya_decimal64(line, length, &value64);
+        status128 = ya_decimal128(line, length, &value128);
+
+        fprintf(stdout, "%i %016llx %i %016llx%016llx\n",
+            (int)status64, (unsigned long long)value64,
+            (int)status128, (unsigned long long)(value128 >> 64), (unsigned long long)value128
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+# Copyright (c) 2011-2013, Take Vos
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+#   this list of conditions and the following disclaimer.
+# - Redistributions in binary form must reproduce the above copyright notice, 
+#   this list of conditions and the following disclaimer in the documentation 
+#   and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+
+# Check ya_decimal64() and ya_decimal128() against the decimal module of Python.
+#
+# Random literals are converted by the decimal_check program, and the resulting bits are decoded with
+# decode_decimal() of the Python reader. The literals cover rounding half to even beyond 16 and 34
+# digits, overflow, subnormal numbers, underflow to zero and the clamping of large exponents.
+#
+# Usage: decimal_check.py path/to/decimal_check
+
+import os
+import sys
+import random
+import decimal
+import subprocess
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "pyext"))
+from parser import decode_decimal
+
+NR_LITERALS = 300000
+
+# The status codes of ya_real_status_t.
+YA_REAL_OK = 0
+YA_REAL_OVERFLOW = 2
+YA_REAL_UNDERFLOW = 3
+
+FORMATS = (
+    # nr_bits, exponent_bits, coefficient_bits, bias, nr_digits, emax
+    (64, 10, 53, 398, 16, 384),
+    (128, 14, 113, 6176, 34, 6144),
+)
+
+def random_literal():
+    nr_digits = random.choice([1, 2, 5, 15, 16, 17, 19, 20, 33, 34, 35, 36, 50])
+    digits = "".join(random.choice("0123456789") for i in range(nr_digits))
+    if random.random() < 0.3:
+        # Half way cases, which are rounded to even.
+        digits = digits[:-1] + "5" + "0" * random.randint(0, 3)
+
+    if random.random() < 0.7:
+        point = random.randint(0, len(digits))
+        literal = digits[:point] + "." + digits[point:]
+    else:
+        literal = digits
+
+    if random.random() < 0.6:
+        literal += "e%i" % random.choice([
+            random.randint(-30, 30),            # Common exponents.
+            random.randint(-420, 400),          # Overflow, subnormal and clamping of decimal64.
+            random.randint(-6200, 6200),        # Overflow, subnormal and clamping of decimal128.
+        ])
+    if random.random() < 0.3:
+        literal = "-" + literal
+    return literal
+
+def literals():
+    random.seed(42)
+    r = [
+        "0", "0.00", "-0", "1.50", "inf", "-inf", "nan",
+        "9999999999999999", "99999999999999995", "99999999999999985",
+        "1e369", "1e384", "1e385", "9.999999999999999e384", "9.9999999999999995e384",
+        "1e-398", "1e-399", "5e-399", "6e-399", "1.0e-398", "1e-383", "1.000000000000000e-383",
+        "1234567890123456789012345678901234567890", "0." + "0" * 30 + "123",
+        "1e6111", "1e6144", "1e6145", "1e-6176", "5e-6177", "6e-6177",
+    ]
+    while len(r) < NR_LITERALS:
+        literal = random_literal()
+        if literal.lstrip("-").startswith(".e") or literal.lstrip("-") == ".":
+            continue
+        r.append(literal)
+    return r
+
+def main(program):
+    inputs = literals()
+    process = subprocess.Popen([program], stdin=subprocess.PIPE, stdout=subprocess.PIPE, universal_newlines=True)
+    output, _ = process.communicate("\n".join(inputs) + "\n")
+    lines = output.splitlines()
+    if process.returncode != 0 or len(lines) != len(inputs):
+        print("%s failed" % program)
+        return 1
+
+    nr_failed = 0
+    for literal, line in zip(inputs, lines):
+        fields = line.split()
+        for (nr_bits, exponent_bits, coefficient_bits, bias, nr_digits, emax), status, bits in (
+            (FORMATS[0], int(fields[0]), int(fields[1], 16)),
+            (FORMATS[1], int(fields[2]), int(fields[3], 16))
+        ):
+            context = decimal.Context(prec=nr_digits, Emax=emax, Emin=1 - emax, clamp=1, traps=[])
+            expected = context.create_decimal(literal)
+
+            if context.flags[decimal.Overflow]:
+                expected_status = YA_REAL_OVERFLOW
+            elif expected.is_zero() and decimal.Decimal(literal) != 0:
+                expected_status = YA_REAL_UNDERFLOW
+            else:
+                expected_status = YA_REAL_OK
+
+            value = decode_decimal(bits, nr_bits, exponent_bits, coefficient_bits, bias, nr_digits)
+            if status != expected_status or (status == YA_REAL_OK and
+                value.as_tuple() != expected.as_tuple() and not (value.is_nan() and expected.is_nan())):
+                nr_failed += 1
+                if nr_failed <= 10:
+                    print("decimal%i %s: status %i value %s, expected status %i value %s" % (
+                        nr_bits, literal, status, value, expected_status, expected))
+
+    print("decimal  %i literals checked, %i differ from the decimal module" % (len(inputs), nr_failed))
+    return 1 if nr_failed > 0 else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
@@ -28,6 +28,7 @@
 #include <stdarg.h>
 #include <yyast/error.h>
 #include <yyast/count.h>
+#include <yyast/context.h>
 
 void ya_error(const char *message, ...)
 {
@@ -41,9 +42,18 @@ void ya_error(const char *message, ...)
 
     if (nr_characters >= 0) {
         fprintf(stderr, "line %i:%i, %s\n", ya_current_position.line + 1, ya_current_position.column + 1, msg);
-        free(msg);
+    } else {
+        msg = NULL;
     }
 
+    if (ya_context->error_jump != NULL) {
+        // Only abandon the current parse, the caller keeps the message.
+        free(ya_context->error_message);
+        ya_context->error_message = msg;
+        longjmp(*ya_context->error_jump, 1);
+    }
+
+    free(msg);
     exit(1);
 }
 
@@ -25,6 +25,12 @@
 #ifndef YA_ERROR_H
 #define YA_ERROR_H
 
-void ya_error(const char *message, ...);
+/** Report an error at the current position.
+ * The process is exited, unless the current context has an error_jump. Then only the
+ * current parse is abandoned by jumping there, and the message is kept in the context.
+ *
+ * @param message   printf() style format of the message.
+ */
+void ya_error(const char *message, ...) __attribute__((noreturn));
 
 #endif
@@ -36,15 +36,46 @@
 #include <yyast/node.h>
 #include <yyast/header.h>
 #include <yyast/count.h>
+#include <yyast/leaf.h>
+#include <yyast/utf8.h>
+#include <yyast/index.h>
+
+/** Check if the source filenames are valid UTF-8.
+ */
+static int ya_filenames_are_utf8(void)
+{
+    uint32_t    i;
+
+    for (i = 0; i < ya_filenames.nr_filenames; i++) {
+        if (ya_utf8_validate(ya_filenames.filenames[i], ya_filenames.lengths[i]) != ya_filenames.lengths[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
 ya_t ya_header(ya_t *document_node)
 {
     // This is executed after the document was parsed, because the document is passed as an argument.
-    ya_t    header;
-    ya_t    filenames = ya_get_filenames();
+    ya_t        header;
+    ya_t        filenames = ya_get_filenames();
+    ya_t        index;
+    const ya_t  *items[] = {&filenames, document_node};
+    uint16_t    flags = 0;
 
-    header = YA_BRANCH("yyast", &filenames, document_node);
+    if (ya_write_index && ya_index_build(&index, items, 2) == 0) {
+        // The index is the last child, so that it does not move the other nodes.
+        header = YA_BRANCH("yyast", &filenames, document_node, &index);
+        flags|= YA_HEADER_FLAG_INDEX;
+    } else {
+        header = YA_BRANCH("yyast", &filenames, document_node);
+    }
     ya_clear_position(&header);
+
+    // The text literals were validated while parsing, the filenames are checked here.
+    if (ya_validate_utf8 && ya_filenames_are_utf8()) {
+        flags|= YA_HEADER_FLAG_UTF8;
+    }
+    ya_node_set_flags(&header, flags);
     return header;
 }
-
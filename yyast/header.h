@@ -25,10 +25,23 @@
 #ifndef YA_HEADER_H
 #define YA_HEADER_H
 
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <yyast/types.h>
 
+/** The text nodes of the file are valid UTF-8.
+ * Set in the root node when the file was parsed with ya_validate_utf8, consumers may
+ * then decode text nodes without validating them again.
+ */
+#define YA_HEADER_FLAG_UTF8     0x0001
+
+/** The last child of the root node is an index of the nodes.
+ * Set when the file was written with ya_write_index, see ya_index_build() in index.h.
+ */
+#define YA_HEADER_FLAG_INDEX    0x0002
+
 /** Create an header node.
  *
  * @param document_node     The node for the full document.
@@ -0,0 +1,299 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <yyast/index.h>
+#include <yyast/leaf.h>
+#include <yyast/count.h>
+#include <yyast/utils.h>
+#include <yyast/reader.h>
+
+/** Offsets and parents of the nodes, in depth first order.
+ */
+typedef struct {
+    uint64_t    *offsets;       ///< File offset of each node.
+    uint32_t    *parents;       ///< Ordinal of the parent of each node.
+    size_t      nr_nodes;       ///< Number of nodes.
+    size_t      capacity;       ///< Number of nodes that fit in the arrays.
+    uint32_t    *levels;        ///< Ordinal of the last node at each level of a serialized subtree.
+    size_t      nr_levels;      ///< Number of levels that fit in levels.
+} ya_index_nodes_t;
+
+/** Children of a deferred node which still need to be visited.
+ */
+typedef struct {
+    const ya_t  *children;      ///< The children.
+    size_t      nr_children;    ///< Number of children.
+    size_t      i;              ///< The next child to visit.
+    uint32_t    parent;         ///< Ordinal of the parent of the children.
+} ya_index_frame_t;
+
+/** Add a node.
+ * @returns The ordinal of the node, or UINT32_MAX when there are too many nodes.
+ */
+static uint32_t ya_index_add(ya_index_nodes_t *nodes, uint64_t offset, uint32_t parent)
+{
+    size_t      capacity;
+
+    if (nodes->nr_nodes >= UINT32_MAX) {
+        return UINT32_MAX;
+    }
+
+    if (nodes->nr_nodes == nodes->capacity) {
+        capacity = nodes->capacity > 0 ? nodes->capacity * 2 : 1024;
+        if ((nodes->offsets = realloc(nodes->offsets, capacity * sizeof (uint64_t))) == NULL ||
+            (nodes->parents = realloc(nodes->parents, capacity * sizeof (uint32_t))) == NULL) {
+            perror("Could not allocate index");
+            abort();
+        }
+        nodes->capacity = capacity;
+    }
+
+    nodes->offsets[nodes->nr_nodes] = offset;
+    nodes->parents[nodes->nr_nodes] = parent;
+    return nodes->nr_nodes++;
+}
+
+/** Add the nodes of a serialized subtree.
+ * @param nodes     The nodes.
+ * @param buf       The serialized subtree.
+ * @param offset    The file offset of the subtree.
+ * @param parent    The ordinal of the parent of the subtree.
+ * @returns         0 on success, -1 when there are too many nodes.
+ */
+static int ya_index_add_serialized(ya_index_nodes_t *nodes, const ya_node_t *buf, uint64_t offset, uint32_t parent)
+{
+    ya_reader_t reader;
+    ya_cursor_t root;
+    ya_cursor_t cursor;
+    ya_walker_t walker;
+    size_t      level;
+    uint32_t    ordinal;
+    int         r;
+
+    if (ya_reader_init(&reader, buf, ntohll(buf->size)) == -1 || ya_reader_root(&reader, &root) == -1 || ya_walker_init(&walker, &root) == -1) {
+        perror("Could not read serialized node");
+        abort();
+    }
+
+    while ((r = ya_walker_next(&walker, &cursor, &level)) == 1) {
+        if (level >= nodes->nr_levels) {
+            nodes->nr_levels = MAX(nodes->nr_levels * 2, 64);
+            if ((nodes->levels = realloc(nodes->levels, nodes->nr_levels * sizeof (uint32_t))) == NULL) {
+                perror("Could not allocate index");
+                abort();
+            }
+        }
+
+        ordinal = ya_index_add(nodes, offset + ((const char *)cursor.node - (const char *)buf), level > 0 ? nodes->levels[level - 1] : parent);
+        if (ordinal == UINT32_MAX) {
+            ya_walker_free(&walker);
+            return -1;
+        }
+        nodes->levels[level] = ordinal;
+    }
+
+    if (r == -1) {
+        perror("Could not read serialized node");
+        abort();
+    }
+    ya_walker_free(&walker);
+    return 0;
+}
+
+/** Add the nodes of the children of a root node, without recursion.
+ * @returns 0 on success, -1 when a list was spooled or there are too many nodes.
+ */
+static int ya_index_add_items(ya_index_nodes_t *nodes, const ya_t * const *items, size_t nr_items)
+{
+    ya_index_frame_t    *stack = NULL;
+    size_t              depth = 0;
+    size_t              capacity = 0;
+    ya_index_frame_t    *frame;
+    const ya_t          *item;
+    const char          *p;
+    const char          *end;
+    uint64_t            offset = sizeof (ya_node_t);
+    uint32_t            ordinal;
+    size_t              i;
+    int                 r = 0;
+
+    for (i = 0; i < nr_items && r == 0; i++) {
+        item = items[i];
+
+        for (;;) {
+            if (item == NULL) {
+                // Continue with the next child of the deepest deferred node.
+                while (depth > 0 && stack[depth - 1].i == stack[depth - 1].nr_children) {
+                    depth--;
+                }
+                if (depth == 0) {
+                    break;
+                }
+                frame = &stack[depth - 1];
+                item = &frame->children[frame->i++];
+            }
+            ordinal = depth > 0 ? stack[depth - 1].parent : 0;
+
+            if (item->type == YA_NODE_TYPE_SPOOL) {
+                // The nodes are in the spool file, they would have to be read back.
+                r = -1;
+                break;
+
+            } else if (item->tree != NULL) {
+                if (item->type != YA_NODE_TYPE_LIST) {
+                    // A list is written without its header, its children belong to the parent of the list.
+                    if ((ordinal = ya_index_add(nodes, offset, ordinal)) == UINT32_MAX) {
+                        r = -1;
+                        break;
+                    }
+                    offset+= sizeof (ya_node_t);
+                }
+
+                if (depth == capacity) {
+                    capacity = MAX(capacity * 2, 64);
+                    if ((stack = realloc(stack, capacity * sizeof (ya_index_frame_t))) == NULL) {
+                        perror("Could not allocate index");
+                        abort();
+                    }
+                }
+                stack[depth].children    = item->tree->children;
+                stack[depth].nr_children = item->tree->nr_children;
+                stack[depth].i           = 0;
+                stack[depth].parent      = ordinal;
+                depth++;
+
+            } else if (item->type == YA_NODE_TYPE_LIST) {
+                // A serialized list is written without its header, only its children.
+                end = (const char *)item->node + item->size;
+                for (p = item->node->data; p < end && r == 0; p+= ntohll(((const ya_node_t *)p)->size)) {
+                    r = ya_index_add_serialized(nodes, (const ya_node_t *)p, offset + (p - item->node->data), ordinal);
+                }
+                offset+= item->size - sizeof (ya_node_t);
+
+            } else {
+                r = ya_index_add_serialized(nodes, item->node, offset, ordinal);
+                offset+= item->size;
+            }
+
+            if (r == -1) {
+                break;
+            }
+            item = NULL;
+        }
+    }
+
+    free(stack);
+    return r;
+}
+
+/** Store a 32 bit integer in big endian.
+ */
+static inline char *ya_index_put32(char *p, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(p, &value, sizeof (value));
+    return p + sizeof (value);
+}
+
+/** Store a 64 bit integer in big endian.
+ */
+static inline char *ya_index_put64(char *p, uint64_t value)
+{
+    value = htonll(value);
+    memcpy(p, &value, sizeof (value));
+    return p + sizeof (value);
+}
+
+int ya_index_build(ya_t *index, const ya_t * const *items, size_t nr_items)
+{
+    ya_index_nodes_t    nodes = {NULL, NULL, 0, 0, NULL, 0};
+    uint32_t            *first_children;
+    uint32_t            *children;
+    char                *buf;
+    char                *p;
+    size_t              buf_size;
+    size_t              i;
+    int                 r = -1;
+
+    // The root node is at the start of the file.
+    ya_index_add(&nodes, 0, UINT32_MAX);
+
+    if (ya_index_add_items(&nodes, items, nr_items) == 0) {
+        // Count the children of each node, then place the children in depth first order after their siblings.
+        if ((first_children = calloc(nodes.nr_nodes + 1, sizeof (uint32_t))) == NULL ||
+            (children = malloc(nodes.nr_nodes * sizeof (uint32_t))) == NULL) {
+            perror("Could not allocate index");
+            abort();
+        }
+        for (i = 1; i < nodes.nr_nodes; i++) {
+            first_children[nodes.parents[i] + 1]++;
+        }
+        for (i = 0; i < nodes.nr_nodes; i++) {
+            first_children[i + 1]+= first_children[i];
+        }
+        for (i = 1; i < nodes.nr_nodes; i++) {
+            children[first_children[nodes.parents[i]]++] = i;
+        }
+        // Filling in the children moved each start to the start of the next node.
+        memmove(&first_children[1], &first_children[0], nodes.nr_nodes * sizeof (uint32_t));
+        first_children[0] = 0;
+
+        buf_size = sizeof (uint64_t) + nodes.nr_nodes * (sizeof (uint64_t) + 3 * sizeof (uint32_t));
+        if ((buf = malloc(buf_size)) == NULL) {
+            perror("Could not allocate index");
+            abort();
+        }
+        p = ya_index_put64(buf, nodes.nr_nodes);
+        for (i = 0; i < nodes.nr_nodes; i++) {
+            p = ya_index_put64(p, nodes.offsets[i]);
+        }
+        for (i = 0; i < nodes.nr_nodes; i++) {
+            p = ya_index_put32(p, nodes.parents[i]);
+        }
+        for (i = 0; i <= nodes.nr_nodes; i++) {
+            p = ya_index_put32(p, first_children[i]);
+        }
+        for (i = 0; i + 1 < nodes.nr_nodes; i++) {
+            p = ya_index_put32(p, children[i]);
+        }
+
+        *index = ya_literal("#index", YA_NODE_TYPE_INDEX, buf, buf_size);
+        ya_clear_position(index);
+        free(buf);
+        free(children);
+        free(first_children);
+        r = 0;
+    }
+
+    free(nodes.offsets);
+    free(nodes.parents);
+    free(nodes.levels);
+    return r;
+}
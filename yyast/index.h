@@ -0,0 +1,59 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_INDEX_H
+#define YA_INDEX_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <yyast/types.h>
+#include <yyast/context.h>
+
+/** Write an index of the nodes as the last child of the root node.
+ * See YA_HEADER_FLAG_INDEX in header.h.
+ */
+#define ya_write_index          (ya_context->write_index)
+
+/** Build the index of a root node.
+ * The index holds the file offset and parent of every node, numbered in depth first order
+ * with the root as node 0, and the children of every node. The index node itself is not
+ * included. Offsets are calculated from the sizes of the nodes, so the index is built before
+ * the tree is serialized.
+ *
+ * The data of the index node is, in big endian:
+ *  - uint64_t nr_nodes
+ *  - uint64_t offsets[nr_nodes]
+ *  - uint32_t parents[nr_nodes], UINT32_MAX for the root.
+ *  - uint32_t first_children[nr_nodes + 1], the children of node i are children[first_children[i]] up to children[first_children[i + 1]].
+ *  - uint32_t children[nr_nodes - 1]
+ *
+ * @param index     The index node, named "#index".
+ * @param items     The children of the root node, before the index.
+ * @param nr_items  Number of children.
+ * @returns         0 on success, -1 when a list was spooled, or there are more than UINT32_MAX nodes.
+ */
+int ya_index_build(ya_t *index, const ya_t * const *items, size_t nr_items);
+
+#endif
@@ -33,17 +33,40 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <arpa/inet.h>
 #include <yyast/leaf.h>
 #include <yyast/count.h>
 #include <yyast/utils.h>
 #include <yyast/error.h>
+#include <yyast/arena.h>
+#include <yyast/real.h>
+#include <yyast/utf8.h>
 
 ya_t ya_null_singleton;
 
+/** Create the null singleton before main() is called.
+ * It is never modified, so it is shared by all contexts.
+ */
+static void __attribute__((constructor)) ya_null_singleton_init(void)
+{
+    ya_null_singleton = ya_null();
+}
+
 ya_t ya_literal(const char * restrict name, ya_type_t type, const void * restrict buf, size_t buf_size)
+{
+    return ya_literal_checked(name, type, buf, buf_size, 1);
+}
+
+ya_t ya_literal_checked(const char * restrict name, ya_type_t type, const void * restrict buf, size_t buf_size, int validate)
 {
     size_t aligned_buf_size = ya_align64(buf_size);
+    size_t offset;
+
+    if (validate && ya_validate_utf8 && type == YA_NODE_TYPE_TEXT && (offset = ya_utf8_validate(buf, buf_size)) != buf_size) {
+        ya_current_position = ya_previous_position;
+        ya_error("Invalid UTF-8 in text literal at byte %zu.", offset);
+    }
 
     ya_t r = {
         .type = type,
@@ -58,15 +81,17 @@ ya_t ya_literal(const char * restrict name, ya_type_t type, const void * restric
         r.position.column = UINT32_MAX;
     }
 
-    // Allocate memory aligned to 32 bit. We need to use calloc so that we don't accidently
+    // Allocate memory aligned to 64 bit. Every field is set explicitly so that we don't accidently
     // leak information into the output file.
-    r.node = calloc(1, r.size);
+    r.node = ya_alloc(r.size);
     r.node->name             = htonll(ya_create_name(name));
     r.node->size             = htonll(sizeof (ya_node_t) + aligned_buf_size);  // The inner length is the length of header+data.
     r.node->type             = r.type;
     r.node->position.file    = htonl(r.position.file);
     r.node->position.line    = htonl(r.position.line);
     r.node->position.column  = htonl(r.position.column);
+    r.node->flags            = 0;
+    r.node->reserved_2       = 0;
 
     memcpy(r.node->data, buf, buf_size);
     // Set padding bytes to zero, so as not to leak data. For security purposes.
@@ -75,92 +100,291 @@ ya_t ya_literal(const char * restrict name, ya_type_t type, const void * restric
 }
 
 
-typedef union {
-    double      d;
-    uint64_t    u;
-    int64_t     i;
-} translate_t;
+ya_t ya_binary_float(const char * restrict name, const char * restrict buf, size_t buf_size, int base, int nr_bits)
+{
+    ya_real_status_t    status;
+    double              value;
+    uint64_t            value64;
+    uint128_t           value128;
+
+    switch (nr_bits) {
+    case 64:
+        status = ya_real64(buf, buf_size, base, &value);
+        memcpy(&value64, &value, sizeof (value64));
+        break;
+    case 128:
+        status = ya_real128(buf, buf_size, base, &value128);
+        break;
+    default:
+        fprintf(stderr, "ya_binary_float does only implement binary64 and binary128.\n");
+        abort();
+    }
+
+    switch (status) {
+    case YA_REAL_OK:
+        break;
+    case YA_REAL_INVALID:
+        ya_error("Could not convert real value '%.*s'", (int)buf_size, buf);
+    case YA_REAL_OVERFLOW:
+        ya_error("Could not convert real value '%.*s', overflow", (int)buf_size, buf);
+    case YA_REAL_UNDERFLOW:
+        ya_error("Could not convert real value '%.*s', underflow", (int)buf_size, buf);
+    case YA_REAL_UNSUPPORTED:
+        ya_error("Could not convert real value '%.*s', binary128 is not supported", (int)buf_size, buf);
+    }
+
+    if (nr_bits == 64) {
+        value64 = htonll(value64);
+        return ya_literal(name, YA_NODE_TYPE_BINARY_FLOAT, &value64, sizeof (value64));
+    } else {
+        value128 = htonlll(value128);
+        return ya_literal(name, YA_NODE_TYPE_BINARY_FLOAT, &value128, sizeof (value128));
+    }
+}
+
+ya_t ya_decimal_float(const char * restrict name, const char * restrict buf, size_t buf_size, int nr_bits)
+{
+    ya_real_status_t    status;
+    uint64_t            value64;
+    uint128_t           value128;
+
+    switch (nr_bits) {
+    case 64:
+        status = ya_decimal64(buf, buf_size, &value64);
+        break;
+    case 128:
+        status = ya_decimal128(buf, buf_size, &value128);
+        break;
+    default:
+        fprintf(stderr, "ya_decimal_float does only implement decimal64 and decimal128.\n");
+        abort();
+    }
+
+    switch (status) {
+    case YA_REAL_OK:
+        break;
+    case YA_REAL_OVERFLOW:
+        ya_error("Could not convert decimal value '%.*s', overflow", (int)buf_size, buf);
+    case YA_REAL_UNDERFLOW:
+        ya_error("Could not convert decimal value '%.*s', underflow", (int)buf_size, buf);
+    default:
+        ya_error("Could not convert decimal value '%.*s'", (int)buf_size, buf);
+    }
+
+    if (nr_bits == 64) {
+        value64 = htonll(value64);
+        return ya_literal(name, YA_NODE_TYPE_DECIMAL_FLOAT, &value64, sizeof (value64));
+    } else {
+        value128 = htonlll(value128);
+        return ya_literal(name, YA_NODE_TYPE_DECIMAL_FLOAT, &value128, sizeof (value128));
+    }
+}
+
+/** Digit values of the three RFC 4648 alphabets, indexed by character.
+ * Characters outside an alphabet have the value UINT8_MAX, which is never below a base.
+ */
+static uint8_t ya_base16_digits[256];
+static uint8_t ya_base32_digits[256];
+static uint8_t ya_base64_digits[256];
+
+/** Fill the digit tables before main() is called.
+ */
+static void __attribute__((constructor)) ya_digits_init(void)
+{
+    int c;
 
-ya_t ya_binary_float(const char * restrict name, const char * restrict buf, size_t buf_size __attribute__((unused)), int base __attribute__((unused)), int nr_bits __attribute__((unused)))
+    memset(ya_base16_digits, UINT8_MAX, sizeof (ya_base16_digits));
+    memset(ya_base32_digits, UINT8_MAX, sizeof (ya_base32_digits));
+    memset(ya_base64_digits, UINT8_MAX, sizeof (ya_base64_digits));
+
+    // RFC 4648, Base-16, extended with the rest of the latin alphabet.
+    for (c = '0'; c <= '9'; c++) { ya_base16_digits[c] = c - '0';      }
+    for (c = 'A'; c <= 'Z'; c++) { ya_base16_digits[c] = c - 'A' + 10; }
+    for (c = 'a'; c <= 'z'; c++) { ya_base16_digits[c] = c - 'a' + 10; }
+
+    // RFC 4648, Base-32
+    for (c = 'a'; c <= 'z'; c++) { ya_base32_digits[c] = c - 'a';      }
+    for (c = 'A'; c <= 'Z'; c++) { ya_base32_digits[c] = c - 'A';      }
+    for (c = '2'; c <= '7'; c++) { ya_base32_digits[c] = c - '2' + 26; }
+
+    // RFC 4648, Base-64
+    for (c = 'A'; c <= 'Z'; c++) { ya_base64_digits[c] = c - 'A';      }
+    for (c = 'a'; c <= 'z'; c++) { ya_base64_digits[c] = c - 'a' + 26; }
+    for (c = '0'; c <= '9'; c++) { ya_base64_digits[c] = c - '0' + 52; }
+    ya_base64_digits['+'] = 62;
+    ya_base64_digits['/'] = 63;
+}
+
+/** Select the digit table for a base.
+ * @param base  The base of the literal.
+ * @returns     The digit table, or NULL when the base is not implemented.
+ */
+static const uint8_t *ya_integer_digits(int base)
 {
-    translate_t t;
-    char        *endptr;
+    if (base == 32) {
+        return ya_base32_digits;
+    } else if (base >= 37 && base <= 64) {
+        return ya_base64_digits;
+    } else if (base >= 0 && base <= 36) {
+        return ya_base16_digits;
+    } else {
+        return NULL;
+    }
+}
+
+#define YA_SWAR_ONES    0x0101010101010101ULL
+
+/** Find the bytes of a word that are within a range of characters.
+ * All the bytes of the word must be 7 bit ASCII.
+ * @param x     Eight characters.
+ * @param first First character of the range.
+ * @param last  Last character of the range.
+ * @returns     The top bit of each byte is set when that character is in the range.
+ */
+static inline uint64_t ya_swar_in_range(uint64_t x, uint8_t first, uint8_t last)
+{
+    return (x + (0x80 - first) * YA_SWAR_ONES) & ~(x + (0x7f - last) * YA_SWAR_ONES) & (0x80 * YA_SWAR_ONES);
+}
 
-    t.d = strtold(buf, &endptr);
-    if (buf == endptr) {
-        ya_error("Could not convert real value '%s'", buf);
+/** Decode eight decimal digits at once.
+ * @param buf   Eight characters.
+ * @param value The value of the digits.
+ * @returns     true if all eight characters are decimal digits.
+ */
+static inline bool ya_swar_decimal(const char * restrict buf, uint64_t * restrict value)
+{
+    uint64_t    x;
+
+    memcpy(&x, buf, sizeof (x));
+    // The first character in the most significant byte.
+    x = ntohll(x);
+    if ((x & (0x80 * YA_SWAR_ONES)) != 0 || ya_swar_in_range(x, '0', '9') != (0x80 * YA_SWAR_ONES)) {
+        return false;
     }
 
-    if ((t.d == HUGE_VALL || t.d == -HUGE_VALL) && errno == ERANGE) {
-        ya_error("Could not convert real value '%s', overflow", buf);
+    x-= '0' * YA_SWAR_ONES;
+    x = ((x >>  8) & 0x00ff00ff00ff00ffULL) * 10    + (x & 0x00ff00ff00ff00ffULL);
+    x = ((x >> 16) & 0x0000ffff0000ffffULL) * 100   + (x & 0x0000ffff0000ffffULL);
+    x = ((x >> 32)                        ) * 10000 + (x & 0x00000000ffffffffULL);
+    *value = x;
+    return true;
+}
+
+/** Decode eight hexadecimal digits at once.
+ * @param buf   Eight characters.
+ * @param value The value of the digits.
+ * @returns     true if all eight characters are hexadecimal digits.
+ */
+static inline bool ya_swar_hexadecimal(const char * restrict buf, uint64_t * restrict value)
+{
+    uint64_t    x;
+
+    memcpy(&x, buf, sizeof (x));
+    // The first character in the most significant byte.
+    x = ntohll(x);
+    if ((x & (0x80 * YA_SWAR_ONES)) != 0 ||
+        (ya_swar_in_range(x, '0', '9') | ya_swar_in_range(x | (0x20 * YA_SWAR_ONES), 'a', 'f')) != (0x80 * YA_SWAR_ONES)) {
+        return false;
     }
 
-    if ((t.d == 0.0 || t.d == -0.0) && errno == ERANGE) {
-        ya_error("Could not convert real value '%s', underflow", buf);
+    // Letters have bit 6 set and a low nibble of 1 to 6, for the values 10 to 15.
+    x = (x & (0x0f * YA_SWAR_ONES)) + ((x >> 6) & YA_SWAR_ONES) * 9;
+    x = (x | (x >>  4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >>  8)) & 0x0000ffff0000ffffULL;
+    x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+    *value = x;
+    return true;
+}
+
+/** Decode the integer literal as long as it fits in 64 bits.
+ * Decimal and hexadecimal literals are decoded eight digits at a time.
+ *
+ * @param digits    Digit table of the alphabet.
+ * @param base      The base of the literal.
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param value     The value of the characters that were decoded.
+ * @returns         The number of characters decoded, less than buf_size when the value does not fit in 64 bits.
+ */
+static size_t ya_integer64(const uint8_t * restrict digits, unsigned int base, const char * restrict buf, size_t buf_size, uint64_t * restrict value)
+{
+    uint64_t    v = 0;
+    uint64_t    chunk;
+    uint64_t    tmp;
+    uint64_t    factor = base == 10 ? 100000000ULL : 0x100000000ULL;
+    bool        swar = base == 10 || base == 16;
+    size_t      i = 0;
+    size_t      end;
+    unsigned    digit;
+
+    while (i < buf_size) {
+        if (swar && buf_size - i >= 8) {
+            if ((base == 10 ? ya_swar_decimal(&buf[i], &chunk) : ya_swar_hexadecimal(&buf[i], &chunk)) &&
+                v <= (UINT64_MAX - chunk) / factor) {
+                v = v * factor + chunk;
+                i+= 8;
+                continue;
+            }
+            // Handle these eight characters one at a time, they include ignored characters or overflow.
+            end = i + 8;
+        } else {
+            end = buf_size;
+        }
+
+        for (; i < end; i++) {
+            digit = digits[(uint8_t)buf[i]];
+            if (digit < base) {
+                // Only characters inside the alphabet are processed, all other characters are ignored.
+                if (__builtin_mul_overflow(v, base, &tmp) || __builtin_add_overflow(tmp, digit, &tmp)) {
+                    *value = v;
+                    return i;
+                }
+                v = tmp;
+            }
+        }
     }
 
-    t.u = htonll(t.u);
-    return ya_literal(name, YA_NODE_TYPE_BINARY_FLOAT, &t.u, sizeof (t.u));
+    *value = v;
+    return i;
 }
 
 ya_t ya_integer(const char * restrict name, ya_type_t type, const char * restrict buf, size_t buf_size, int base)
 {
-    int                 i = 0;
-    char                c;
+    const uint8_t       *digits = ya_integer_digits(base);
+    size_t              i;
     uint128_t           value;
     uint128_t           value128;
     uint64_t            value64;
-    int                 digit;
-
-    value = 0;
-    for (i = 0; i < buf_size; i++) {
-        c = buf[i];
-
-        if (base == 32) {
-            // RFC 4648, Base-32
-            if      (c >= 'a' && c <= 'z')  { digit = c - 'a';      }
-            else if (c >= 'A' && c <= 'Z')  { digit = c - 'A';      }
-            else if (c >= '2' && c <= '7')  { digit = c - '2' + 26; }
-            else                            { digit = base;         }
-
-        } else if (base >= 37 && base <= 64) {
-            // RFC 4648, Base-64
-            if      (c >= 'A' && c <= 'Z')  { digit = c - 'A';      }
-            else if (c >= 'a' && c <= 'z')  { digit = c - 'a' + 26; }
-            else if (c >= '0' && c <= '9')  { digit = c - '0' + 52; }
-            else if (c == '+'            )  { digit = 62;           }
-            else if (c == '/'            )  { digit = 63;           }
-            else                            { digit = base;         }
-
-        } else if (base >= 0 && base <= 36) {
-            // RFC 4648, Base-16
-            if      (c >= '0' && c <= '9')  { digit = c - '0';      }
-            else if (c >= 'A' && c <= 'Z')  { digit = c - 'A' + 10; }
-            else if (c >= 'a' && c <= 'z')  { digit = c - 'a' + 10; }
-            else                            { digit = base;         }
+    unsigned            digit;
 
-        } else {
-            fprintf(stderr, "ya_integer does not implement a base above 64.\n");
-            abort();
+    if (digits == NULL) {
+        if (buf_size == 0) {
+            value64 = 0;
+            return ya_literal(name, type, &value64, sizeof(value64));
         }
+        fprintf(stderr, "ya_integer does not implement a base above 64.\n");
+        abort();
+    }
+
+    i = ya_integer64(digits, base, buf, buf_size, &value64);
+    if (i == buf_size) {
+        value64 = htonll(value64);
+        return ya_literal(name, type, &value64, sizeof(value64));
+    }
 
-        if (digit < base) {
-            // Only characters inside the alphabet are processed, all other characters are ignored.
-            value *= base;
-            if (value + digit < value) {
+    // Only literals that do not fit in 64 bits are decoded with 128 bit arithmetic.
+    value = value64;
+    for (; i < buf_size; i++) {
+        digit = digits[(uint8_t)buf[i]];
+        if (digit < (unsigned)base) {
+            if (__builtin_mul_overflow(value, (unsigned)base, &value) || __builtin_add_overflow(value, digit, &value)) {
                 ya_error("Overflow of integer literal");
             }
-            value += digit;
         }
     }
 
-    if (value <= UINT64_MAX) {
-        value64 = htonll(value);
-        return ya_literal(name, type, &value64, sizeof(value64));
-    } else {
-        value128 = htonlll(value);
-        return ya_literal(name, type, &value128, sizeof(value128));
-    }
+    value128 = htonlll(value);
+    return ya_literal(name, type, &value128, sizeof(value128));
 }
 
 ya_t ya_text(const char * restrict name, const char * restrict buf, size_t buf_size)
@@ -173,6 +397,97 @@ ya_t ya_leaf(const char * restrict name)
     return ya_literal(name, YA_NODE_TYPE_LEAF, NULL, 0);
 }
 
+/** Find the slot of a template in the hash table.
+ * @param templates The templates to search.
+ * @param name      The name of the template, in network byte order.
+ * @returns         The slot holding the template, or the empty slot where it should be added.
+ */
+static uint32_t ya_leaf_template_slot(const ya_leaf_templates_t *templates, ya_name_t name)
+{
+    uint32_t    mask = templates->table_size - 1;
+    uint32_t    slot = (name * 0x9e3779b97f4a7c15ULL) >> 32 & mask;
+
+    while (templates->table[slot] != NULL && templates->table[slot]->name != name) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/** Double the size of the hash table, keeping it at most half full.
+ */
+static void ya_leaf_templates_grow(ya_leaf_templates_t *templates)
+{
+    ya_node_t   **old_table = templates->table;
+    uint32_t    old_table_size = templates->table_size;
+    uint32_t    i;
+
+    templates->table_size = old_table_size > 0 ? old_table_size * 2 : 64;
+    if ((templates->table = calloc(templates->table_size, sizeof (ya_node_t *))) == NULL) {
+        perror("Could not allocate leaf templates");
+        abort();
+    }
+
+    for (i = 0; i < old_table_size; i++) {
+        if (old_table[i] != NULL) {
+            templates->table[ya_leaf_template_slot(templates, old_table[i]->name)] = old_table[i];
+        }
+    }
+    free(old_table);
+}
+
+ya_t ya_shared_leaf(const char * restrict name)
+{
+    ya_leaf_templates_t *templates = &ya_context->leaf_templates;
+    ya_name_t           network_name = htonll(ya_create_name(name));
+    ya_node_t           *template;
+    uint32_t            slot;
+
+    ya_t r = {
+        .type     = YA_NODE_TYPE_LEAF,
+        .size     = sizeof (ya_node_t),
+        .position = ya_previous_position,
+        .shared   = 1,
+    };
+
+    if (templates->nr_templates * 2 >= templates->table_size) {
+        ya_leaf_templates_grow(templates);
+    }
+
+    slot = ya_leaf_template_slot(templates, network_name);
+    if ((template = templates->table[slot]) == NULL) {
+        // The template is not allocated with ya_alloc(), as it outlives the arena of a single parse.
+        if ((template = malloc(sizeof (ya_node_t))) == NULL) {
+            perror("Could not allocate leaf template");
+            abort();
+        }
+        template->name             = network_name;
+        template->size             = htonll(sizeof (ya_node_t));
+        template->type             = YA_NODE_TYPE_LEAF;
+        template->position.file    = UINT32_MAX;
+        template->position.line    = UINT32_MAX;
+        template->position.column  = UINT32_MAX;
+        template->flags            = 0;
+        template->reserved_2       = 0;
+
+        templates->table[slot] = template;
+        templates->nr_templates++;
+    }
+
+    r.node = template;
+    return r;
+}
+
+void ya_leaf_templates_free(ya_leaf_templates_t *templates)
+{
+    uint32_t    i;
+
+    for (i = 0; i < templates->table_size; i++) {
+        free(templates->table[i]);
+    }
+    free(templates->table);
+    memset(templates, 0, sizeof (ya_leaf_templates_t));
+}
+
 ya_t ya_null(void)
 {
     return ya_literal("#null", YA_NODE_TYPE_NULL, NULL, 0);
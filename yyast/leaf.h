@@ -27,11 +27,12 @@
 
 #include <yyast/types.h>
 #include <yyast/utils.h>
+#include <yyast/context.h>
 
 /** Ya_null is a singleton, so that it can be
  * referenced by pointer by the YA_NULL macro.
  *
- * The singleton is initialized in ya_main().
+ * The singleton is initialized when the program is started, and shared by all contexts.
  * The node functions will not free this, or any, ya_null leafs.
  */
 extern ya_t ya_null_singleton;
@@ -44,7 +45,14 @@ ya_t ya_null(void);
  */
 #define YA_NULL (&ya_null_singleton)
 
+/** Validate that text literals are UTF-8.
+ * When set, ya_text() reports invalid UTF-8 through ya_error(), and ya_header() marks the
+ * file with YA_HEADER_FLAG_UTF8.
+ */
+#define ya_validate_utf8        (ya_context->validate_utf8)
+
 /** Create an literal node.
+ * When ya_validate_utf8 is set, text nodes must be valid UTF-8, the error is reported at the start of the token.
  *
  * @param name      name of the node.
  * @param type      type of leaf node.
@@ -53,17 +61,42 @@ ya_t ya_null(void);
  */
 ya_t ya_literal(const char * restrict name, ya_type_t type, const void * restrict buf, size_t buf_size);
 
+/** Create an literal node, with or without checking text nodes for UTF-8.
+ * Used for text that does not come from the parsed source, like the filenames which are checked by ya_header().
+ *
+ * @param name      name of the node.
+ * @param type      type of leaf node.
+ * @param buf       The memory which needs to be copied.
+ * @param buf_size  The amount of memory to be copied.
+ * @param validate  When non-zero and ya_validate_utf8 is set, a text node must be valid UTF-8.
+ */
+ya_t ya_literal_checked(const char * restrict name, ya_type_t type, const void * restrict buf, size_t buf_size, int validate);
+
 /** Create literal node from floating point literal string.
+ * The literal is converted independent of the locale and correctly rounded, see ya_real64().
+ * The string does not need to be nul terminated.
  *
  * @param name      name of the node.
  * @param buf       Literal as string.
  * @param buf_size  String size.
- * @param base            
- * @param nr_bits   Nr of bits in the floating point format, only 64 bits is supported.
+ * @param base      The base of the literal, 10 or 16. Literals starting with "0x" are always hexadecimal.
+ * @param nr_bits   Nr of bits in the floating point format, 64 for binary64 or 128 for binary128.
  * @returns         The decoded literal node.
  */
 ya_t ya_binary_float(const char * restrict name, const char * restrict buf, size_t buf_size, int base, int nr_bits);
 
+/** Create literal node from a decimal floating point literal string.
+ * The literal is encoded as an IEEE 754 decimal64 or decimal128 in the binary integer decimal (BID)
+ * encoding. The coefficient and exponent are kept as written, see ya_decimal64().
+ *
+ * @param name      name of the node.
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param nr_bits   Nr of bits in the floating point format, 64 for decimal64 or 128 for decimal128.
+ * @returns         The decoded literal node.
+ */
+ya_t ya_decimal_float(const char * restrict name, const char * restrict buf, size_t buf_size, int nr_bits);
+
 /** Create literal from an integer literal string.
  * The RFC 4648 is used as a guide for encoding integers.
  *
@@ -117,6 +150,7 @@ ya_t ya_positive_integer(const char * restrict name, const char * restrict buf,
 ya_t ya_negative_integer(const char * restrict name, const char * restrict buf, size_t buf_size, int base);
 
 /** Create text literal node for a string literal.
+ * When ya_validate_utf8 is set, the text must be valid UTF-8, the error is reported at the start of the token.
  *
  * @param name      name of the node.
  * @param buf       Literal as string.
@@ -129,8 +163,22 @@ ya_t ya_text(const char * restrict name, const char * restrict buf, size_t buf_s
  */
 ya_t ya_leaf(const char * restrict name);
 
+/** Shared leaf node, does not contain data or children.
+ * Keywords and punctuation are very common, so instead of allocating a node for each of them,
+ * all leaves with the same name reference a single immutable template. The position of the
+ * leaf is only patched into the header when it is written into its parent.
+ *
+ * The templates are owned by the current context, and are released by ya_context_destroy().
+ */
+ya_t ya_shared_leaf(const char * restrict name);
+
+/** Release the shared leaf templates.
+ * @param templates The templates to free, they are left empty.
+ */
+void ya_leaf_templates_free(ya_leaf_templates_t *templates);
+
 /** Leaf node, does not contain data or children.
  */
-#define YA_LEAF(name) ya_leaf(name)
+#define YA_LEAF(name) ya_shared_leaf(name)
 
 #endif
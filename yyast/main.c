@@ -26,28 +26,96 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <yyast/main.h>
 #include <yyast/utils.h>
 #include <yyast/node.h>
 #include <yyast/count.h>
 #include <yyast/leaf.h>
+#include <yyast/arena.h>
+#include <yyast/index.h>
 
-extern FILE *yyin;
-int yyparse();
+/** The input of a non-reentrant lexer.
+ * This is weak, so that a program with a reentrant lexer, which has no global yyin, or a program which only
+ * uses the node functions can link without it. ya_main() and ya_parse_buffer() fail when it is missing.
+ */
+extern FILE *yyin __attribute__((weak));
+
+/** The parser called by ya_main() and ya_parse_buffer().
+ * This is weak for the same reason as yyin.
+ */
+int yyparse() __attribute__((weak));
+
+/** Reset the flex scanner to a new input file.
+ * This is weak, so that ya_main() can be used with a hand written lexer.
+ */
+void yyrestart(FILE *input_file) __attribute__((weak));
+
+/** Scan a buffer in place with flex.
+ * This is weak, so that ya_parse_buffer() can be used with a hand written lexer.
+ */
+void *yy_scan_buffer(char *base, size_t size) __attribute__((weak));
 
-char *ya_output_filename = NULL;
-char *ya_input_filename = NULL;
+/** Release a buffer created by yy_scan_buffer().
+ */
+void yy_delete_buffer(void *buffer) __attribute__((weak));
+
+/** Size of the blocks read from an input which can not be mapped.
+ */
+#define YA_READ_BLOCK_SIZE  (1024 * 1024)
+
+/** Input which is scanned in place by flex with yy_scan_buffer().
+ */
+typedef struct {
+    char        *base;          ///< The input, followed by the two nul characters flex needs.
+    size_t      size;           ///< Number of bytes of the input.
+    size_t      mapped_size;    ///< Size of the mapping, or zero when base was allocated.
+    void        *scan_state;    ///< The flex buffer, or NULL when not being scanned.
+} ya_scan_input_t;
+
+int ya_use_arena_option = 0;
+int ya_stream_option = 0;
+int ya_stats_option = 0;
+int ya_jobs_option = 1;
+char **ya_input_filenames = NULL;
+int ya_nr_input_filenames = 0;
+char *ya_server_option = NULL;
+int ya_mmap_option = 0;
+
+/** The input of the file being parsed with -m, so that it can be closed after a ya_error().
+ */
+static ya_scan_input_t ya_scan_input;
 
 void ya_usage(char *application, int exit_code)
 {
     fprintf(stderr, "Usage:\n");
     fprintf(stderr, "  %s -h\n", application);
-    fprintf(stderr, "  %s [-c] [-o output file] input file\n", application);
+    fprintf(stderr, "  %s [-c] [-d] [-w] [-a] [-s] [-m] [-u] [-i] [-o output file] input file\n", application);
+    fprintf(stderr, "  %s [-c] [-d] [-w] [-a] [-s] [-m] [-u] [-i] [-j jobs] input file...\n", application);
+    fprintf(stderr, "  %s [-c] [-d] [-w] [-s] [-m] [-u] [-i] -S socket\n", application);
     fprintf(stderr, "\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -h   Show help message\n");
     fprintf(stderr, "  -c   Compile, this option is ignored\n");
+    fprintf(stderr, "  -d   Defer serialization of the tree until it is saved\n");
+    fprintf(stderr, "  -w   Write finished parts of large lists early, to bound memory usage\n");
+    fprintf(stderr, "  -a   Allocate nodes from an arena\n");
+    fprintf(stderr, "  -s   Show allocation statistics\n");
+    fprintf(stderr, "  -m   Scan the input file in place with mmap, this requires a flex lexer\n");
+    fprintf(stderr, "  -u   Validate that text literals are UTF-8, and mark the output as validated\n");
+    fprintf(stderr, "  -i   Write an index of the node offsets, for random access, this can not be used with -w\n");
+    fprintf(stderr, "  -j   Number of files to parse at the same time, the default is 1\n");
     fprintf(stderr, "  -o   Set the output file, the default is the same as the input file\n");
+    fprintf(stderr, "  -S   Serve parse requests on a unix socket, or on stdin and stdout for '-'\n");
     fprintf(stderr, "\n");
     exit(exit_code);
 }
@@ -55,14 +123,24 @@ void ya_usage(char *application, int exit_code)
 void ya_parse_options(int argc, char *argv[], char *extension)
 {
     int             ch;
+    char            *application = argv[0];
     struct option   longopts[] = {
-        {"output",  required_argument, NULL, 'o'},
-        {"compile", no_argument,       NULL, 'c'},
-        {"help",    no_argument,       NULL, 'h'},
-        {NULL,      0,                 NULL, 0}
+        {"output",   required_argument, NULL, 'o'},
+        {"compile",  no_argument,       NULL, 'c'},
+        {"deferred", no_argument,       NULL, 'd'},
+        {"stream",   no_argument,       NULL, 'w'},
+        {"arena",    no_argument,       NULL, 'a'},
+        {"stats",    no_argument,       NULL, 's'},
+        {"mmap",     no_argument,       NULL, 'm'},
+        {"utf8",     no_argument,       NULL, 'u'},
+        {"index",    no_argument,       NULL, 'i'},
+        {"jobs",     required_argument, NULL, 'j'},
+        {"server",   required_argument, NULL, 'S'},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL,       0,                 NULL, 0}
     };
 
-    while ((ch = getopt_long(argc, argv, "hco:", longopts, NULL)) != -1) {
+    while ((ch = getopt_long(argc, argv, "hcdwasmuij:o:S:", longopts, NULL)) != -1) {
         switch (ch) {
         case 'o':
             // Set the output filename.
@@ -74,6 +152,46 @@ void ya_parse_options(int argc, char *argv[], char *extension)
         case 'c':
             // Compile, which is the only mode it supports.
             break;
+        case 'd':
+            // Build a tree of references and serialize it once when saving.
+            ya_deferred = 1;
+            break;
+        case 'w':
+            // Write finished parts of large lists to a spool file, this requires a deferred tree.
+            ya_stream_option = 1;
+            ya_deferred = 1;
+            break;
+        case 'a':
+            // Allocate all nodes from an arena, which is released at once.
+            ya_use_arena_option = 1;
+            break;
+        case 's':
+            // Show allocation statistics when done.
+            ya_stats_option = 1;
+            break;
+        case 'm':
+            // Map the input file and let flex scan it in place.
+            ya_mmap_option = 1;
+            break;
+        case 'u':
+            // Report text literals which are not UTF-8 as errors.
+            ya_validate_utf8 = 1;
+            break;
+        case 'i':
+            // Add an index of the nodes as the last child of the root.
+            ya_write_index = 1;
+            break;
+        case 'S':
+            // Keep running, and parse the files of each request.
+            ya_server_option = optarg;
+            break;
+        case 'j':
+            // Number of worker processes when parsing multiple files.
+            if ((ya_jobs_option = atoi(optarg)) < 1) {
+                fprintf(stderr, "The number of jobs must be at least 1.\n");
+                ya_usage(argv[0], 2);
+            }
+            break;
         case 0:
             break;
         case ':':
@@ -90,30 +208,223 @@ void ya_parse_options(int argc, char *argv[], char *extension)
     argc -= optind;
     argv += optind;
 
-    if (argc != 1) {
-        fprintf(stderr, "Expecting a single filename.\n");
-        ya_usage(argv[0], 2);
+    if (ya_write_index && ya_stream_option) {
+        // The index would need the nodes which were already written to the spool file.
+        fprintf(stderr, "An index can not be written when streaming.\n");
+        ya_usage(application, 2);
     }
 
-    ya_input_filename = argv[0];
+    if (ya_server_option != NULL) {
+        if (argc != 0 || ya_output_filename != NULL) {
+            fprintf(stderr, "The files are given by the requests in server mode.\n");
+            ya_usage(application, 2);
+        }
+        return;
+    }
 
-    if (ya_output_filename == NULL) {
-        // output file was not explicityly set, therfor we generate it from the input filename.
-        ya_output_filename = ya_new_extension(ya_input_filename, extension);
+    if (argc < 1) {
+        fprintf(stderr, "Expecting at least one filename.\n");
+        ya_usage(application, 2);
+    }
+
+    if (argc > 1 && ya_output_filename != NULL) {
+        fprintf(stderr, "The output file can only be set when parsing a single file.\n");
+        ya_usage(application, 2);
     }
+
+    ya_input_filenames = argv;
+    ya_nr_input_filenames = argc;
 }
 
-int ya_main(int argc, char *argv[], char *extension)
+/** Start scanning an input with flex.
+ * @param input     An input with two nul characters after its data.
+ * @returns         0 on success, -1 on failure.
+ */
+static int ya_scan_start(ya_scan_input_t *input)
 {
-    FILE    *out;
-    char    *reposition_s;
+    if ((input->scan_state = yy_scan_buffer(input->base, input->size + 2)) == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
 
-    // Initialize singletons.
-    ya_null_singleton = ya_null();
+/** Map a regular file as input.
+ * The file is mapped copy-on-write, as flex temporarily modifies the buffer. An anonymous
+ * mapping is reserved first, so that there are zero bytes directly after the file for the
+ * two nul characters, even when the file ends on a page boundary.
+ *
+ * @param input     The input to fill in.
+ * @param fd        The file to map.
+ * @param size      The size of the file.
+ * @returns         0 on success, -1 on failure.
+ */
+static int ya_scan_map(ya_scan_input_t *input, int fd, size_t size)
+{
+    size_t  page_size = sysconf(_SC_PAGESIZE);
+    size_t  mapped_size = (size + 2 + page_size - 1) & ~(page_size - 1);
+    void    *base;
 
-    ya_parse_options(argc, argv, extension);
+    if ((base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        return -1;
+    }
+    if (size > 0 && mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, mapped_size);
+        return -1;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    input->base        = base;
+    input->size        = size;
+    input->mapped_size = mapped_size;
+    return 0;
+}
+
+/** Read an input which can not be mapped, such as a pipe.
+ * @param input     The input to fill in.
+ * @param fd        The file to read until the end.
+ * @returns         0 on success, -1 on failure.
+ */
+static int ya_scan_read(ya_scan_input_t *input, int fd)
+{
+    size_t  capacity = 0;
+    ssize_t nr_bytes;
+    char    *base;
+
+    input->base = NULL;
+    input->size = 0;
+    input->mapped_size = 0;
+
+    for (;;) {
+        if (capacity - input->size < YA_READ_BLOCK_SIZE + 2) {
+            capacity = capacity > 0 ? capacity * 2 : YA_READ_BLOCK_SIZE * 4;
+            if ((base = realloc(input->base, capacity)) == NULL) {
+                free(input->base);
+                input->base = NULL;
+                return -1;
+            }
+            input->base = base;
+        }
+
+        if ((nr_bytes = read(fd, &input->base[input->size], capacity - input->size - 2)) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(input->base);
+            input->base = NULL;
+            return -1;
+        }
+        if (nr_bytes == 0) {
+            break;
+        }
+        input->size+= nr_bytes;
+    }
+
+    input->base[input->size] = 0;
+    input->base[input->size + 1] = 0;
+    return 0;
+}
+
+/** Open a file to be scanned in place by flex.
+ * Regular files are mapped, other files and "-" for stdin are read in large blocks.
+ *
+ * @param input     The input to fill in.
+ * @param filename  The file to open, or "-" for stdin.
+ * @returns         0 on success, -1 on failure with errno set.
+ */
+static int ya_scan_open(ya_scan_input_t *input, const char *filename)
+{
+    struct stat st;
+    int         fd;
+    int         r;
+    int         saved_errno;
+
+    memset(input, 0, sizeof (ya_scan_input_t));
+
+    if (strcmp(filename, "-") == 0) {
+        r = ya_scan_read(input, STDIN_FILENO);
+    } else {
+        if ((fd = open(filename, O_RDONLY)) == -1) {
+            return -1;
+        }
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            r = ya_scan_map(input, fd, st.st_size);
+        } else {
+            r = ya_scan_read(input, fd);
+        }
+        saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+    }
+
+    return r == 0 ? ya_scan_start(input) : -1;
+}
+
+/** Stop scanning an input and release its memory.
+ * @param input     The input to close, which may already be closed.
+ */
+static void ya_scan_close(ya_scan_input_t *input)
+{
+    if (input->scan_state != NULL) {
+        yy_delete_buffer(input->scan_state);
+    }
+    if (input->mapped_size > 0) {
+        munmap(input->base, input->mapped_size);
+    } else {
+        free(input->base);
+    }
+    memset(input, 0, sizeof (ya_scan_input_t));
+
+    // flex sets yyin to stdin when it starts scanning, which must not be read by a next parse.
+    yyin = NULL;
+}
 
-    if (strcmp(ya_input_filename, "-") == 0) {
+/** Check that the program has the non-reentrant parser and lexer which are used to parse a file.
+ * @returns     0 when yyparse() and yyin are linked in, -1 otherwise.
+ */
+static int ya_check_parser(void)
+{
+    if (yyparse == NULL || &yyin == NULL) {
+        fprintf(stderr, "Could not find yyparse() and yyin with C linkage.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/** Parse a single file and save its AST.
+ *
+ * @param input_filename    The file to parse, or "-" for stdin.
+ * @param output_filename   The file to write the AST to, or "-" for stdout.
+ * @returns                 0 on success, -1 on failure with errno set, or with errno zero when yyparse() failed.
+ */
+static int ya_parse_file(char *input_filename, char *output_filename)
+{
+    FILE        *out;
+    char        *reposition_s;
+    ya_arena_t  arena;
+    int         r;
+
+    ya_input_filename = input_filename;
+    ya_output_filename = output_filename;
+
+    if (ya_use_arena_option) {
+        ya_arena_init(&arena, 0);
+        ya_use_arena(&arena);
+    }
+
+    if (ya_stream_option) {
+        if ((ya_spool = ya_spool_open(ya_output_filename)) == NULL) {
+            perror("Could not create spool file");
+            return -1;
+        }
+    }
+
+    if (ya_mmap_option && yy_scan_buffer != NULL) {
+        if (ya_scan_open(&ya_scan_input, ya_input_filename) == -1) {
+            perror("Could not open input file");
+            return -1;
+        }
+    } else if (strcmp(ya_input_filename, "-") == 0) {
         yyin = stdin;
     } else {
         if ((yyin = fopen(ya_input_filename, "r")) == NULL) {
@@ -127,13 +438,40 @@ int ya_main(int argc, char *argv[], char *extension)
         free(reposition_s);
     }
 
-    yyparse();
-    fclose(yyin);
+    if (ya_scan_input.base == NULL && yyin != NULL && yyrestart != NULL) {
+        // Forget the state of a previous file. A scanned input already has a fresh flex buffer, and
+        // yyrestart() would replace it with yyin.
+        yyrestart(yyin);
+    }
+
+    r = yyparse();
+    if (ya_scan_input.base != NULL) {
+        ya_scan_close(&ya_scan_input);
+    } else {
+        fclose(yyin);
+        yyin = NULL;
+    }
+
+    if (r != 0) {
+        // The parse was aborted without ya_error(), for example by YYABORT, ya_start is not a complete tree.
+        fprintf(stderr, "Could not parse input file.\n");
+        if (ya_spool != NULL) {
+            fclose(ya_spool);
+            ya_spool = NULL;
+        }
+        if (ya_use_arena_option) {
+            ya_use_arena(NULL);
+            ya_arena_destroy(&arena);
+        }
+        errno = 0;
+        return -1;
+    }
 
     if (strcmp(ya_output_filename, "-") == 0) {
         out = stdout;
     } else {
-        if ((out = fopen(ya_output_filename, "w")) == NULL) {
+        // Opened for reading as well, as ya_node_save() can only map a file which is open for reading and writing.
+        if ((out = fopen(ya_output_filename, "w+")) == NULL) {
             perror("Could not open output file");
             return -1;
         }
@@ -141,5 +479,390 @@ int ya_main(int argc, char *argv[], char *extension)
     ya_node_save(out, &ya_start);
     fclose(out);
 
+    if (ya_spool != NULL) {
+        fclose(ya_spool);
+        ya_spool = NULL;
+    }
+
+    if (ya_stats_option) {
+        ya_print_alloc_stats(stderr);
+    }
+
+    if (ya_use_arena_option) {
+        // Release the whole tree at once.
+        ya_use_arena(NULL);
+        ya_arena_destroy(&arena);
+    }
+
     return 0;
 }
+
+/** Parse each input file in its own worker process.
+ * At most ya_jobs_option workers run at the same time. Each worker starts with a fresh copy
+ * of the parser state, and a failing file, for example through ya_error(), only ends its own worker.
+ *
+ * @param extension The extension of the AST files.
+ * @returns         0 when all files were parsed, 1 when one or more files failed.
+ */
+static int ya_batch(char *extension)
+{
+    pid_t   *pids;
+    pid_t   pid;
+    int     status;
+    int     i;
+    int     next_file = 0;
+    int     nr_running = 0;
+    int     nr_failed = 0;
+
+    if ((pids = calloc(ya_nr_input_filenames, sizeof (pid_t))) == NULL) {
+        perror("Could not allocate worker table");
+        return 1;
+    }
+
+    while (next_file < ya_nr_input_filenames || nr_running > 0) {
+        if (next_file < ya_nr_input_filenames && nr_running < ya_jobs_option) {
+            // Don't let the worker write out buffered data of the parent.
+            fflush(NULL);
+
+            if ((pid = fork()) == -1) {
+                perror("Could not start worker");
+                fprintf(stderr, "%s: failed\n", ya_input_filenames[next_file]);
+                nr_failed++;
+                next_file++;
+
+            } else if (pid == 0) {
+                // Worker.
+                i = ya_parse_file(ya_input_filenames[next_file], ya_new_extension(ya_input_filenames[next_file], extension));
+                _exit(i == 0 ? 0 : 1);
+
+            } else {
+                pids[next_file++] = pid;
+                nr_running++;
+            }
+            continue;
+        }
+
+        if ((pid = wait(&status)) == -1) {
+            perror("Could not wait for worker");
+            nr_failed+= nr_running;
+            break;
+        }
+
+        // Other children of the program may be reaped here as well, those are not workers.
+        for (i = 0; i < next_file && pids[i] != pid; i++);
+        if (i == next_file) {
+            continue;
+        }
+        pids[i] = 0;
+        nr_running--;
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            continue;
+        }
+
+        nr_failed++;
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "%s: failed, killed by signal %i\n", ya_input_filenames[i], WTERMSIG(status));
+        } else {
+            fprintf(stderr, "%s: failed\n", ya_input_filenames[i]);
+        }
+    }
+
+    free(pids);
+    return nr_failed > 0 ? 1 : 0;
+}
+
+/** Initialize the context of a single request.
+ * The settings from the command line are taken from the default context.
+ *
+ * @param context       The context to initialize.
+ * @param error_jump    Where ya_error() jumps to, so that it only abandons the request.
+ */
+static void ya_request_context_init(ya_context_t *context, jmp_buf *error_jump)
+{
+    ya_context_init(context);
+    context->deferred        = ya_default_context.deferred;
+    context->validate_utf8   = ya_default_context.validate_utf8;
+    context->write_index     = ya_default_context.write_index;
+    context->spool_threshold = ya_default_context.spool_threshold;
+    context->error_jump      = error_jump;
+}
+
+int ya_parse_buffer(char *input_filename, const char *buffer, size_t buffer_size, const ya_allocator_t *output_allocator, char **ast, size_t *ast_size)
+{
+    ya_context_t    context;
+    ya_context_t    *previous_context;
+    jmp_buf         error_jump;
+    ya_arena_t      arena;
+    ya_scan_input_t input = {NULL, 0, 0, NULL};
+    volatile int    r = -1;                 // volatile, as it is used after a longjmp from ya_error().
+    char            *reposition_s;
+
+    *ast = NULL;
+    *ast_size = 0;
+
+    if (ya_check_parser() == -1) {
+        return -1;
+    }
+
+    if (yy_scan_buffer != NULL) {
+        // flex scans the buffer in place, and needs two nul characters at the end.
+        if ((input.base = malloc(buffer_size + 2)) == NULL) {
+            perror("Could not allocate scan buffer");
+            return -1;
+        }
+        memcpy(input.base, buffer, buffer_size);
+        input.base[buffer_size] = 0;
+        input.base[buffer_size + 1] = 0;
+        input.size = buffer_size;
+        if (ya_scan_start(&input) == -1) {
+            fprintf(stderr, "Could not scan buffer.\n");
+            ya_scan_close(&input);
+            return -1;
+        }
+    } else {
+        // Read the buffer through yyin, for a lexer which does not support yy_scan_buffer().
+        if ((yyin = fmemopen((void *)buffer, buffer_size, "r")) == NULL) {
+            perror("Could not open buffer");
+            return -1;
+        }
+    }
+
+    ya_request_context_init(&context, &error_jump);
+    previous_context = ya_context_switch(&context);
+    ya_arena_init(&arena, 0);
+    ya_use_arena(&arena);
+    ya_input_filename = input_filename;
+
+    if (setjmp(error_jump) == 0) {
+        if (asprintf(&reposition_s, "1 \"%s\"", ya_input_filename) >= 0) {
+            ya_reposition(reposition_s, strlen(reposition_s));
+            free(reposition_s);
+        }
+
+        if (yyparse() == 0) {
+            // Serialize the complete tree into a single buffer for the caller.
+            *ast_size = ya_start.size;
+            if (output_allocator != NULL) {
+                *ast = output_allocator->alloc(output_allocator->context, *ast_size);
+            } else {
+                *ast = malloc(*ast_size);
+            }
+
+            if (*ast == NULL) {
+                perror("Could not allocate AST");
+                *ast_size = 0;
+            } else {
+                ya_node_serialize(*ast, &ya_start);
+                r = 0;
+            }
+        }
+    }
+
+    if (input.base != NULL) {
+        ya_scan_close(&input);
+    } else {
+        fclose(yyin);
+        yyin = NULL;
+    }
+
+    // The tree is released with the arena, even when the parse was abandoned.
+    ya_context_switch(previous_context);
+    ya_context_destroy(&context);
+    ya_arena_destroy(&arena);
+    return r;
+}
+
+/** Parse the files of a single server request.
+ * The request is parsed with a fresh context, and its nodes are allocated from the arena of the server.
+ *
+ * @param input_filename    The file to parse.
+ * @param output_filename   The file to write the AST to.
+ * @param arena             The arena of the server, which is reset after the request.
+ * @returns                 The reply, which must be free-ed by the caller.
+ */
+static char *ya_serve_request(char *input_filename, char *output_filename, ya_arena_t *arena)
+{
+    ya_context_t    context;
+    jmp_buf         error_jump;
+    char            *reply = NULL;
+
+    ya_request_context_init(&context, &error_jump);
+    ya_context_switch(&context);
+    ya_use_arena(arena);
+
+    if (strcmp(input_filename, "-") == 0 || strcmp(output_filename, "-") == 0) {
+        reply = strdup("error stdin and stdout can not be used in server mode");
+
+    } else if (setjmp(error_jump) == 0) {
+        errno = 0;
+        if (ya_parse_file(input_filename, output_filename) == 0) {
+            reply = strdup("ok");
+        } else if (asprintf(&reply, "error %s", errno != 0 ? strerror(errno) : "could not parse input file") < 0) {
+            reply = NULL;
+        }
+
+    } else {
+        // ya_error() abandoned the parse, close the files it left open.
+        if (ya_scan_input.base != NULL) {
+            ya_scan_close(&ya_scan_input);
+        } else if (yyin != NULL) {
+            fclose(yyin);
+            yyin = NULL;
+        }
+        if (asprintf(&reply, "error line %i:%i, %s", ya_current_position.line + 1, ya_current_position.column + 1,
+            context.error_message != NULL ? context.error_message : "unknown error") < 0) {
+            reply = NULL;
+        }
+    }
+
+    if (ya_spool != NULL) {
+        fclose(ya_spool);
+        ya_spool = NULL;
+    }
+
+    ya_context_switch(NULL);
+    ya_context_destroy(&context);
+    ya_arena_reset(arena);
+    return reply;
+}
+
+/** Handle requests from a client until it closes the connection.
+ * Each request is a line with an input filename and optionally a tab followed by an output filename.
+ * Each reply is a line with "ok", or "error" followed by a message.
+ *
+ * @param in        Requests from the client.
+ * @param out       Replies to the client.
+ * @param extension The extension of the AST files.
+ * @param arena     The arena of the server.
+ */
+static void ya_serve(FILE *in, FILE *out, char *extension, ya_arena_t *arena)
+{
+    char        *line = NULL;
+    size_t      line_size = 0;
+    ssize_t     line_length;
+    char        *output_filename;
+    char        *derived_filename;
+    char        *reply;
+
+    while ((line_length = getline(&line, &line_size, in)) > 0) {
+        if (line[line_length - 1] == '\n') {
+            line[--line_length] = 0;
+        }
+        if (line_length == 0) {
+            // An empty line ends the session.
+            break;
+        }
+
+        derived_filename = NULL;
+        if ((output_filename = strchr(line, '\t')) != NULL) {
+            *output_filename++ = 0;
+        } else {
+            output_filename = derived_filename = ya_new_extension(line, extension);
+        }
+
+        reply = ya_serve_request(line, output_filename, arena);
+        fprintf(out, "%s\n", reply != NULL ? reply : "error out of memory");
+        fflush(out);
+        free(reply);
+        free(derived_filename);
+    }
+    free(line);
+}
+
+/** Parse files on request, without starting a new process for each file.
+ *
+ * @param path      Path of the unix socket to listen on, or "-" to use stdin and stdout.
+ * @param extension The extension of the AST files.
+ * @returns         -1 when the server could not be started.
+ */
+static int ya_server(char *path, char *extension)
+{
+    ya_arena_t          arena;
+    struct sockaddr_un  address;
+    int                 server_fd;
+    int                 fd;
+    FILE                *in;
+    FILE                *out;
+
+    // All requests are allocated from the same arena, which keeps its chunks between requests.
+    ya_arena_init(&arena, 0);
+    ya_use_arena_option = 0;
+
+    if (strcmp(path, "-") == 0) {
+        ya_serve(stdin, stdout, extension, &arena);
+        ya_arena_destroy(&arena);
+        return 0;
+    }
+
+    if (strlen(path) >= sizeof (address.sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        return -1;
+    }
+    memset(&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if ((server_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        perror("Could not create socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof (address)) == -1 || listen(server_fd, 16) == -1) {
+        perror("Could not listen on socket");
+        close(server_fd);
+        return -1;
+    }
+
+    for (;;) {
+        if ((fd = accept(server_fd, NULL, NULL)) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Could not accept connection");
+            break;
+        }
+
+        if ((in = fdopen(fd, "r")) == NULL || (out = fdopen(dup(fd), "w")) == NULL) {
+            perror("Could not open connection");
+            if (in != NULL) {
+                fclose(in);
+            } else {
+                close(fd);
+            }
+            continue;
+        }
+
+        ya_serve(in, out, extension, &arena);
+        fclose(in);
+        fclose(out);
+    }
+
+    close(server_fd);
+    unlink(path);
+    ya_arena_destroy(&arena);
+    return -1;
+}
+
+int ya_main(int argc, char *argv[], char *extension)
+{
+    ya_parse_options(argc, argv, extension);
+
+    if (ya_check_parser() == -1) {
+        return 1;
+    }
+
+    if (ya_server_option != NULL) {
+        return ya_server(ya_server_option, extension);
+    }
+
+    if (ya_nr_input_filenames > 1) {
+        return ya_batch(extension);
+    }
+
+    if (ya_output_filename == NULL) {
+        // output file was not explicityly set, therfor we generate it from the input filename.
+        ya_output_filename = ya_new_extension(ya_input_filenames[0], extension);
+    }
+    return ya_parse_file(ya_input_filenames[0], ya_output_filename);
+}
@@ -25,6 +25,27 @@
 #ifndef YA_MAIN_H
 #define YA_MAIN_H
 
+#include <stddef.h>
+#include <yyast/arena.h>
+
 int ya_main(int argc, char *argv[], char *extension);
 
+/** Parse a buffer in memory and return the serialized AST.
+ * This allows a compiler to embed the parser, without writing the AST to a file and reading it back.
+ *
+ * The buffer is scanned with yy_scan_buffer() when the lexer is generated by flex, otherwise
+ * it is read through yyin. The parse uses a fresh context, and a ya_error() only fails this call.
+ * The settings of the default context, like ya_deferred, are used.
+ * A reentrant parser has no yyparse(void) and yyin, and can not be used with ya_parse_buffer() or ya_main().
+ *
+ * @param input_filename    Name of the source, which is recorded in the header of the AST.
+ * @param buffer            The source text.
+ * @param buffer_size       The number of bytes in the buffer.
+ * @param output_allocator  Allocator for the returned AST, or NULL to use malloc().
+ * @param ast               Returns the serialized AST, owned by the caller.
+ * @param ast_size          Returns the number of bytes in the AST.
+ * @returns                 0 on success, -1 when the buffer could not be parsed.
+ */
+int ya_parse_buffer(char *input_filename, const char *buffer, size_t buffer_size, const ya_allocator_t *output_allocator, char **ast, size_t *ast_size);
+
 #endif
@@ -33,32 +33,97 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <yyast/node.h>
 #include <yyast/utils.h>
 #include <yyast/config.h>
 #include <yyast/count.h>
+#include <yyast/arena.h>
 
 ya_t YA_NODE_DEFAULT = {
     .type  = YA_NODE_TYPE_NULL,
     .position = {.line = UINT32_MAX, .column = UINT32_MAX, .file = UINT32_MAX},
     .size  = sizeof (ya_node_t),
-    .node  = NULL
+    .shared = 0,
+    .node  = NULL,
+    .tree  = NULL
 };
 
-ya_t ya_generic_nodev(const char * restrict name, ya_type_t type, va_list ap)
+/** Set the position in the header of a node.
+ */
+static inline void ya_node_set_position(ya_node_t *header, ya_position_t position)
+{
+    header->position.file   = htonl(position.file);
+    header->position.line   = htonl(position.line);
+    header->position.column = htonl(position.column);
+}
+
+/** Fill in the header of a node.
+ */
+static inline void ya_node_header(ya_node_t *header, ya_name_t name, ya_type_t type, uint64_t size, ya_position_t position, uint16_t flags)
+{
+    header->name            = htonll(name);
+    header->size            = htonll(size);
+    ya_node_set_position(header, position);
+    header->flags           = htons(flags);
+    header->reserved_2      = 0;
+    header->type            = type;
+}
+
+/** Make sure a tree can hold a number of children.
+ * The capacity grows geometrically, so that appending to a list is amortized O(1).
+ *
+ * @param tree          The tree to grow, or NULL to allocate a new tree.
+ * @param nr_children   The number of children the tree needs to hold.
+ * @returns             The tree, which may have moved.
+ */
+static ya_tree_t *ya_tree_reserve(ya_tree_t *tree, size_t nr_children)
+{
+    size_t      capacity;
+
+    if (tree == NULL) {
+        tree = ya_alloc(sizeof (ya_tree_t) + nr_children * sizeof (ya_t));
+        tree->nr_children = 0;
+        tree->capacity    = nr_children;
+
+    } else if (tree->capacity < nr_children) {
+        capacity = MAX(tree->capacity * 2, nr_children);
+        tree = ya_realloc(tree, sizeof (ya_tree_t) + tree->capacity * sizeof (ya_t), sizeof (ya_tree_t) + capacity * sizeof (ya_t));
+        tree->capacity = capacity;
+    }
+
+    return tree;
+}
+
+/** Free a tree without freeing its children.
+ */
+static void ya_tree_free(ya_tree_t *tree)
+{
+    ya_dealloc(tree, sizeof (ya_tree_t) + tree->capacity * sizeof (ya_t));
+}
+
+static void ya_spool_list(ya_t *list);
+
+/** Number of children of a node which are collected on the stack.
+ */
+#define YA_NODE_STACK_ITEMS 16
+
+ya_t ya_node_array(ya_name_t name, ya_type_t type, ya_t * const *items, size_t nr_items)
 {
-    va_list ap2;
     ya_t    *item;
-    size_t  item_size   = 0;
+    size_t  i;
+    size_t  nr_children = 0;
     ya_t    self        = YA_NODE_DEFAULT;
-    off_t   self_offset = 0;
-
-    va_copy(ap2, ap);
+    uint64_t spooled_size = 0;
+    char    *self_data;
 
     // Calculate the size and position of the content.
     self.type = type;
-    for (item = va_arg(ap, ya_t *); item != NULL; item = va_arg(ap, ya_t *)) {
+    for (i = 0; i < nr_items; i++) {
+        item = items[i];
         if (self.position.file == UINT32_MAX && item->position.file != UINT32_MAX) {
             // The first node which has a file (not UINT32_MAX) is used for where self is located.
             self.position.file   = item->position.file;
@@ -84,52 +149,66 @@ ya_t ya_generic_nodev(const char * restrict name, ya_type_t type, va_list ap)
         case YA_NODE_TYPE_LIST:
             // A list node inserts the child nodes into self, therefor the header of the list node is not included.
             self.size+= item->size - sizeof (ya_node_t);
+            // A deferred list adds each of its children, a serialized list is kept as a single child.
+            nr_children+= item->tree != NULL ? item->tree->nr_children : 1;
+            spooled_size+= item->tree != NULL ? item->tree->spooled_size : 0;
             break;
 
         default:
             // This is a normal node, it will be copied as a normal child into self.
             self.size+= item->size;
+            nr_children++;
         }
     }
 
-    // With the content header.
-    self.node = calloc(1, self.size);
-    self.node->name                 = htonll(ya_create_name(name));
-    self.node->type                 = self.type;
-    self.node->size                 = htonll(self.size);
-    self.node->position.file     = htonl(self.position.file);
-    self.node->position.line     = htonl(self.position.line);
-    self.node->position.column   = htonl(self.position.column);
+    if (ya_deferred || self.type == YA_NODE_TYPE_LIST) {
+        // Only record the children, they are serialized when the tree is saved.
+        i = 0;
+        if (nr_items > 0 && items[0]->type == YA_NODE_TYPE_LIST && items[0]->tree != NULL) {
+            // Extend the first list in place, this makes a left recursive list linear in time.
+            self.tree = ya_tree_reserve(items[0]->tree, nr_children);
+            items[0]->tree = NULL;
+            i = 1;
+        } else {
+            self.tree = ya_tree_reserve(NULL, nr_children);
+        }
+        self.tree->name         = name;
+        self.tree->position     = self.position;
+        self.tree->spool_offset = 0;
+        self.tree->spooled_size = spooled_size;
+        self.tree->flags        = 0;
 
-    // Add the content of the items to the new list.
-    for (item = va_arg(ap2, ya_t *); item != NULL; item = va_arg(ap2, ya_t *)) {
-        switch (item->type) {
-        case YA_NODE_TYPE_COUNT:
-            fprintf(stderr, "Found YA_NODE_TYPE_COUNT token, which is only allowed for line counting\n");
-            abort();
+        for (; i < nr_items; i++) {
+            item = items[i];
+            if (item->type == YA_NODE_TYPE_LIST && item->tree != NULL) {
+                // Take over the children of a deferred list, without the list itself.
+                memcpy(&self.tree->children[self.tree->nr_children], item->tree->children, item->tree->nr_children * sizeof (ya_t));
+                self.tree->nr_children+= item->tree->nr_children;
+                ya_tree_free(item->tree);
+            } else {
+                self.tree->children[self.tree->nr_children++] = *item;
+            }
+        }
 
-        case YA_NODE_TYPE_LIST:
-            // Only copy the contents of a list, without the header.
-            item_size = item->size - sizeof (ya_node_t);
-            memcpy(&(self.node->data[self_offset]), item->node->data, item_size);
-            self_offset+= item_size;
-            break;
+    } else {
+        // With the content header.
+        self.node = ya_alloc(self.size);
+        ya_node_header(self.node, name, self.type, self.size, self.position, 0);
 
-        default:
-            // Copy all of the node including the header.
-            item_size = item->size;
-            memcpy(&(self.node->data[self_offset]), item->node, item_size);
-            self_offset+= item_size;
-        }
+        // Add the content of the items to the new node.
+        self_data = self.node->data;
+        for (i = 0; i < nr_items; i++) {
+            self_data = ya_node_serialize(self_data, items[i]);
 
-        // Now that the child node is copied in self, we should free() it.
-        // The singleton YA_NULL, should not be free-ed.
-        if (item->type != YA_NODE_TYPE_NULL) {
-            free(item->node);
+            // Now that the child node is copied in self, we should free() it.
+            ya_node_free(items[i]);
         }
     }
 
-    va_end(ap2);
+    if (ya_spool != NULL && self.type == YA_NODE_TYPE_LIST && self.size - sizeof (ya_node_t) - self.tree->spooled_size > ya_spool_threshold) {
+        // The list is to large to keep in memory, the items in the list will not move anymore.
+        ya_spool_list(&self);
+    }
 
     // Make sure the this node has a position, if not take it from the current position of the parser.
     if (self.position.file == UINT32_MAX) {
@@ -139,6 +218,41 @@ ya_t ya_generic_nodev(const char * restrict name, ya_type_t type, va_list ap)
     return self;
 }
 
+ya_t ya_generic_nodev(const char * restrict name, ya_type_t type, va_list ap)
+{
+    ya_t    *stack_items[YA_NODE_STACK_ITEMS];
+    ya_t    **items = stack_items;
+    ya_t    **new_items;
+    size_t  capacity = YA_NODE_STACK_ITEMS;
+    size_t  nr_items = 0;
+    ya_t    *item;
+    ya_t    self;
+
+    // Collect the children, so that they can be walked more than once.
+    for (item = va_arg(ap, ya_t *); item != NULL; item = va_arg(ap, ya_t *)) {
+        if (nr_items == capacity) {
+            capacity*= 2;
+            if ((new_items = malloc(capacity * sizeof (ya_t *))) == NULL) {
+                perror("Could not allocate children");
+                abort();
+            }
+            memcpy(new_items, items, nr_items * sizeof (ya_t *));
+            if (items != stack_items) {
+                free(items);
+            }
+            items = new_items;
+        }
+        items[nr_items++] = item;
+    }
+
+    self = ya_node_array(ya_create_name(name), type, items, nr_items);
+
+    if (items != stack_items) {
+        free(items);
+    }
+    return self;
+}
+
 ya_t ya_generic_node(const char * restrict name, ya_type_t type, ...)
 {
     ya_t   r;
@@ -175,8 +289,270 @@ ya_t ya_list(const char * restrict name, ...)
     return r;
 }
 
+/** Copy data from the spool file.
+ *
+ * @param output_file   The file to write to, this may be the spool file itself.
+ * @param offset        Offset in the spool file.
+ * @param size          Number of bytes to copy.
+ */
+static void ya_spool_copy(FILE *output_file, uint64_t offset, uint64_t size)
+{
+    char    buf[65536];
+    ssize_t buf_size;
+
+    // Make sure the data is in the file, the range is located before anything that is written.
+    fflush(ya_spool);
+
+    while (size > 0) {
+        if ((buf_size = pread(fileno(ya_spool), buf, MIN(size, sizeof (buf)), offset)) <= 0) {
+            perror("Could not read from spool file");
+            abort();
+        }
+        fwrite(buf, buf_size, 1, output_file);
+        offset+= buf_size;
+        size-= buf_size;
+    }
+}
+
+char *ya_node_serialize(char *buf, const ya_t *node)
+{
+    size_t  i;
+    size_t  spooled_size;
+
+    if (node->type == YA_NODE_TYPE_SPOOL) {
+        // Read the serialized nodes back from the spool file.
+        fflush(ya_spool);
+        spooled_size = node->size - sizeof (ya_node_t);
+        if (pread(fileno(ya_spool), buf, spooled_size, node->tree->spool_offset) != spooled_size) {
+            perror("Could not read from spool file");
+            abort();
+        }
+        return buf + spooled_size;
+    }
+
+    if (node->tree == NULL) {
+        if (node->type == YA_NODE_TYPE_LIST) {
+            // Only copy the contents of a list, without the header.
+            memcpy(buf, node->node->data, node->size - sizeof (ya_node_t));
+            return buf + node->size - sizeof (ya_node_t);
+        } else {
+            // Copy all of the node including the header.
+            memcpy(buf, node->node, node->size);
+            if (node->shared) {
+                // Only the position differs between the uses of a shared leaf.
+                ya_node_set_position((ya_node_t *)buf, node->position);
+            }
+            return buf + node->size;
+        }
+    }
+
+    if (node->type != YA_NODE_TYPE_LIST) {
+        ya_node_header((ya_node_t *)buf, node->tree->name, node->type, node->size, node->tree->position, node->tree->flags);
+        buf+= sizeof (ya_node_t);
+    }
+
+    for (i = 0; i < node->tree->nr_children; i++) {
+        buf = ya_node_serialize(buf, &node->tree->children[i]);
+    }
+    return buf;
+}
+
+/** Write a deferred node and its children to a file.
+ * Just like ya_node_serialize() a list is written without its header.
+ */
+static void ya_node_write(FILE *output_file, const ya_t *node)
+{
+    ya_node_t   header;
+    size_t      i;
+
+    if (node->type == YA_NODE_TYPE_SPOOL) {
+        ya_spool_copy(output_file, node->tree->spool_offset, node->size - sizeof (ya_node_t));
+        return;
+    }
+
+    if (node->tree == NULL) {
+        if (node->type == YA_NODE_TYPE_LIST) {
+            fwrite(node->node->data, node->size - sizeof (ya_node_t), 1, output_file);
+        } else if (node->shared) {
+            // Only the position differs between the uses of a shared leaf, which has no data.
+            header = *node->node;
+            ya_node_set_position(&header, node->position);
+            fwrite(&header, sizeof (header), 1, output_file);
+        } else {
+            fwrite(node->node, node->size, 1, output_file);
+        }
+        return;
+    }
+
+    if (node->type != YA_NODE_TYPE_LIST) {
+        ya_node_header(&header, node->tree->name, node->type, node->size, node->tree->position, node->tree->flags);
+        fwrite(&header, sizeof (header), 1, output_file);
+    }
+
+    for (i = 0; i < node->tree->nr_children; i++) {
+        ya_node_write(output_file, &node->tree->children[i]);
+    }
+}
+
+/** Write the children of a list to the spool file.
+ * The children which are in memory are replaced by a single spool node.
+ */
+static void ya_spool_list(ya_t *list)
+{
+    ya_tree_t   *tree = list->tree;
+    ya_t        *spooled;
+    size_t      i;
+    size_t      first = 0;
+    uint64_t    offset;
+    uint64_t    size;
+
+    // Children at the start of the list which are already spooled stay where they are.
+    while (first < tree->nr_children && tree->children[first].type == YA_NODE_TYPE_SPOOL) {
+        first++;
+    }
+
+    // The spool file is only appended to.
+    offset = ftello(ya_spool);
+    for (i = first; i < tree->nr_children; i++) {
+        ya_node_write(ya_spool, &tree->children[i]);
+        ya_node_free(&tree->children[i]);
+    }
+    size = ftello(ya_spool) - offset;
+
+    spooled = first > 0 ? &tree->children[first - 1] : NULL;
+    if (spooled != NULL && spooled->tree->spool_offset + spooled->size - sizeof (ya_node_t) == offset) {
+        // Directly following the previous part of the list in the spool file.
+        spooled->size+= size;
+        tree->nr_children = first;
+
+    } else {
+        spooled = &tree->children[first];
+        *spooled = YA_NODE_DEFAULT;
+        spooled->type     = YA_NODE_TYPE_SPOOL;
+        spooled->size     = sizeof (ya_node_t) + size;
+        spooled->position = list->position;
+        spooled->tree     = ya_tree_reserve(NULL, 0);
+        spooled->tree->name         = 0;
+        spooled->tree->position     = list->position;
+        spooled->tree->spool_offset = offset;
+        spooled->tree->spooled_size = size;
+        spooled->tree->flags        = 0;
+        tree->nr_children = first + 1;
+    }
+
+    // Everything in the list is now located in the spool file.
+    tree->spooled_size = list->size - sizeof (ya_node_t);
+}
+
+FILE *ya_spool_open(const char *output_filename)
+{
+    char    *template;
+    int     fd;
+    FILE    *spool;
+
+    if (output_filename == NULL || strcmp(output_filename, "-") == 0) {
+        return tmpfile();
+    }
+
+    if (asprintf(&template, "%s.XXXXXX", output_filename) == -1) {
+        return NULL;
+    }
+    if ((fd = mkstemp(template)) != -1) {
+        // The file is removed when it is closed.
+        unlink(template);
+    }
+    free(template);
+
+    if (fd == -1) {
+        return NULL;
+    }
+    if ((spool = fdopen(fd, "w+")) == NULL) {
+        close(fd);
+    }
+    return spool;
+}
+
+/** Serialize a node into a mapping of the output file.
+ * This avoids copying the AST through the buffer of the file pointer.
+ *
+ * @param output_file   A regular file, positioned at its start and opened for reading and writing, as with "w+".
+ * @param node          The node to be saved to file.
+ * @returns             0 on success, -1 when the file can not be mapped and should be written instead.
+ */
+static int ya_node_save_mapped(FILE *output_file, const ya_t *node)
+{
+    int         fd = fileno(output_file);
+    struct stat st;
+    char        *base;
+
+    if (node->size == 0 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || ftello(output_file) != 0) {
+        return -1;
+    }
+
+    // A shared writable mapping needs a file which is open for reading as well.
+    if ((fcntl(fd, F_GETFL) & O_ACCMODE) != O_RDWR) {
+        return -1;
+    }
+
+    fflush(output_file);
+    if (ftruncate(fd, node->size) == -1) {
+        return -1;
+    }
+
+    // Allocate the blocks now, so that a full disk is found here instead of by a SIGBUS while writing to the mapping.
+    if (fallocate(fd, 0, 0, node->size) == -1 && errno != EOPNOTSUPP) {
+        return -1;
+    }
+
+    if ((base = mmap(NULL, node->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        return -1;
+    }
+    madvise(base, node->size, MADV_SEQUENTIAL);
+
+    ya_node_serialize(base, node);
+
+    munmap(base, node->size);
+    fseeko(output_file, node->size, SEEK_SET);
+    return 0;
+}
+
 void ya_node_save(FILE *output_file, ya_t *node)
 {
-    fwrite(node->node, node->size, 1, output_file);
+    if (node->tree == NULL && !node->shared) {
+        // A large fwrite() is passed directly to write(), a mapping would only add page faults.
+        fwrite(node->node, node->size, 1, output_file);
+    } else if (ya_node_save_mapped(output_file, node) == -1) {
+        ya_node_write(output_file, node);
+    }
+}
+
+void ya_node_set_flags(ya_t *node, uint16_t flags)
+{
+    if (node->tree != NULL) {
+        node->tree->flags = flags;
+    } else if (node->node != NULL && !node->shared) {
+        node->node->flags = htons(flags);
+    }
+}
+
+void ya_node_free(ya_t *node)
+{
+    size_t  i;
+
+    // The singleton YA_NULL and shared leaves, should not be free-ed.
+    if (node->type == YA_NODE_TYPE_NULL || node->shared) {
+        return;
+    }
+
+    if (node->tree != NULL) {
+        for (i = 0; i < node->tree->nr_children; i++) {
+            ya_node_free(&node->tree->children[i]);
+        }
+        ya_tree_free(node->tree);
+        node->tree = NULL;
+    }
+
+    ya_dealloc(node->node, node->size);
+    node->node = NULL;
 }
 
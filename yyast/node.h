@@ -25,9 +25,40 @@
 #ifndef YA_NODE_H
 #define YA_NODE_H
 
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <yyast/types.h>
+#include <yyast/context.h>
+
+/** Defer serialization of branches and lists.
+ * When zero (the default) a branch is serialized as soon as it is created, which copies
+ * the data of each child into the new branch.
+ * When non-zero a branch only records references to its children. The complete tree is
+ * serialized once by ya_node_save(). In this mode the node member of a branch is NULL.
+ *
+ * Lists are always deferred, so that appending to a list does not copy the list.
+ */
+#define ya_deferred             (ya_context->deferred)
+
+/** Default value of ya_spool_threshold.
+ */
+#define YA_SPOOL_THRESHOLD  (1024 * 1024)
+
+/** Spool file for writing finished parts of large lists.
+ * When set, a list which holds more than ya_spool_threshold bytes in memory is serialized
+ * to the end of the spool file, and its children are replaced by a reference to the spool.
+ * ya_node_save() copies these parts from the spool into the output file.
+ *
+ * This keeps memory bounded by the part of the tree which is still being parsed.
+ * It should be used together with ya_deferred.
+ */
+#define ya_spool                (ya_context->spool)
+
+/** Number of bytes a list may hold in memory before it is written to the spool.
+ */
+#define ya_spool_threshold      (ya_context->spool_threshold)
 
 /** Define a new node.
  * Used in a yacc action to start a new node.
@@ -84,11 +115,62 @@ ya_t ya_branch(const char * restrict name, ...);
  */
 ya_t ya_list(const char * restrict name, ...);
 
+/** Create a node from an array of children.
+ * This is the implementation of ya_branch() and ya_list(), for callers which already
+ * know the name and the children, such as the templates in yyast.hpp.
+ * This will free memory used by the children.
+ *
+ * @param name      Name of the node, see ya_create_name().
+ * @param type      YA_NODE_TYPE_BRANCH or YA_NODE_TYPE_LIST.
+ * @param items     The children.
+ * @param nr_items  Number of children.
+ * @returns         A new AST NODE.
+ */
+ya_t ya_node_array(ya_name_t name, ya_type_t type, ya_t * const *items, size_t nr_items);
+
+/** Set the flags in the header of a node.
+ * Flags are only used in the root node, see YA_HEADER_FLAG_UTF8 in header.h.
+ *
+ * @param node          A branch, which is either serialized or deferred.
+ * @param flags         The flags to write in the header.
+ */
+void ya_node_set_flags(ya_t *node, uint16_t flags);
+
+/** Serialize a node into memory.
+ * Deferred children are serialized in the same pass.
+ * When the node is a list, only the children of the list are serialized.
+ *
+ * @param buf           Memory of at least node->size bytes.
+ * @param node          The node to serialize.
+ * @returns             A pointer just after the last byte written.
+ */
+char *ya_node_serialize(char *buf, const ya_t *node);
+
 /** Save the node to a file.
+ * When the file is a regular file, it is resized to the size of the node and mapped, and the
+ * node is serialized directly into the mapping. Otherwise, for example for stdout or a pipe,
+ * the node is written through the file pointer.
+ * Deferred children are written directly to the file, each node is written exactly once.
  *
  * @param output_file   A file pointer of an file open for writing.
  * @param node          The node to be saved to file.
  */
 void ya_node_save(FILE *output_file, ya_t *node);
 
+/** Create a spool file.
+ * The spool file is created in the same directory as the output file, so that it is located
+ * on a disk large enough to hold the output file. The file is removed when it is closed.
+ *
+ * @param output_filename   Name of the output file, or "-" for stdout.
+ * @returns                 A file open for reading and writing, or NULL on error.
+ */
+FILE *ya_spool_open(const char *output_filename);
+
+/** Free the memory used by a node and its children.
+ * The YA_NULL singleton is not free-ed.
+ *
+ * @param node          The node to free.
+ */
+void ya_node_free(ya_t *node);
+
 #endif
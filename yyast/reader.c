@@ -0,0 +1,473 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <yyast/reader.h>
+#include <yyast/header.h>
+
+static void ya_reader_find_index(ya_reader_t *reader);
+
+int ya_reader_open(ya_reader_t *reader, const char *filename)
+{
+    int         fd;
+    struct stat fd_st;
+    void        *buf;
+    int         saved_errno;
+
+    if ((fd = open(filename, O_RDONLY)) == -1) {
+        return -1;
+    }
+
+    if (fstat(fd, &fd_st) == -1) {
+        saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    if (fd_st.st_size == 0) {
+        // An empty file can not be mapped, and does not contain a root node.
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((buf = mmap(NULL, fd_st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    // The mapping stays valid after the file is closed.
+    close(fd);
+
+    reader->buf    = buf;
+    reader->size   = fd_st.st_size;
+    reader->mapped = 1;
+    ya_reader_find_index(reader);
+    return 0;
+}
+
+int ya_reader_init(ya_reader_t *reader, const void *buf, size_t size)
+{
+    if (((uintptr_t)buf & 7) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    reader->buf    = buf;
+    reader->size   = size;
+    reader->mapped = 0;
+    ya_reader_find_index(reader);
+    return 0;
+}
+
+void ya_reader_close(ya_reader_t *reader)
+{
+    if (reader->mapped) {
+        munmap((void *)reader->buf, reader->size);
+    }
+    reader->buf      = NULL;
+    reader->size     = 0;
+    reader->mapped   = 0;
+    reader->index    = NULL;
+    reader->nr_nodes = 0;
+}
+
+/** Point a cursor at a node.
+ * Only the header of the node is checked, its data is checked when its children are visited.
+ *
+ * @param cursor    The cursor to set.
+ * @param p         Start of the node.
+ * @param end       End of the data of the parent.
+ * @returns         1 on success, -1 when the node does not fit before end.
+ */
+static int ya_cursor_set(ya_cursor_t *cursor, const char *p, const char *end)
+{
+    uint64_t    size;
+
+    if ((size_t)(end - p) < sizeof (ya_node_t)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size = ntohll(((const ya_node_t *)p)->size);
+    if (size < sizeof (ya_node_t) || size > (uint64_t)(end - p) || (size & 7) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cursor->node = (const ya_node_t *)p;
+    cursor->end  = end;
+    return 1;
+}
+
+int ya_reader_root(const ya_reader_t *reader, ya_cursor_t *cursor)
+{
+    return ya_cursor_set(cursor, reader->buf, reader->buf + reader->size);
+}
+
+int ya_cursor_first_child(const ya_cursor_t *parent, ya_cursor_t *child)
+{
+    const char  *end = (const char *)parent->node + ntohll(parent->node->size);
+
+    if (parent->node->type != YA_NODE_TYPE_BRANCH || parent->node->data == end) {
+        return 0;
+    }
+    return ya_cursor_set(child, parent->node->data, end);
+}
+
+int ya_cursor_next_sibling(ya_cursor_t *cursor)
+{
+    const char  *next = (const char *)cursor->node + ntohll(cursor->node->size);
+
+    if (next == cursor->end) {
+        return 0;
+    }
+    return ya_cursor_set(cursor, next, cursor->end);
+}
+
+/** Read a 64 bit integer from the index.
+ */
+static inline uint64_t ya_index_get64(const char *p)
+{
+    uint64_t    value;
+
+    memcpy(&value, p, sizeof (value));
+    return ntohll(value);
+}
+
+/** Read a 32 bit integer from the index.
+ */
+static inline uint32_t ya_index_get32(const char *p)
+{
+    uint32_t    value;
+
+    memcpy(&value, p, sizeof (value));
+    return ntohl(value);
+}
+
+/** File offset of a node in the index.
+ */
+static inline uint64_t ya_index_offset(const ya_reader_t *reader, uint64_t ordinal)
+{
+    return ya_index_get64(reader->index + sizeof (uint64_t) * (1 + ordinal));
+}
+
+/** Parent of a node in the index, UINT32_MAX for the root.
+ */
+static inline uint32_t ya_index_parent(const ya_reader_t *reader, uint64_t ordinal)
+{
+    return ya_index_get32(reader->index + sizeof (uint64_t) * (1 + reader->nr_nodes) + sizeof (uint32_t) * ordinal);
+}
+
+/** Position of the first child of a node in the children of the index.
+ */
+static inline uint32_t ya_index_first_child(const ya_reader_t *reader, uint64_t ordinal)
+{
+    return ya_index_get32(reader->index + sizeof (uint64_t) * (1 + reader->nr_nodes) + sizeof (uint32_t) * (reader->nr_nodes + ordinal));
+}
+
+/** A child in the children of the index.
+ */
+static inline uint32_t ya_index_child(const ya_reader_t *reader, uint64_t i)
+{
+    return ya_index_get32(reader->index + sizeof (uint64_t) * (1 + reader->nr_nodes) + sizeof (uint32_t) * (2 * reader->nr_nodes + 1 + i));
+}
+
+/** Find the index, which is the last child of the root node.
+ * A file with a malformed index is read without it.
+ */
+static void ya_reader_find_index(ya_reader_t *reader)
+{
+    ya_cursor_t root;
+    ya_cursor_t child;
+    ya_cursor_t last;
+    uint64_t    nr_nodes;
+    size_t      data_size;
+
+    reader->index    = NULL;
+    reader->nr_nodes = 0;
+
+    if (ya_reader_root(reader, &root) != 1 || (ya_cursor_flags(&root) & YA_HEADER_FLAG_INDEX) == 0) {
+        return;
+    }
+
+    // The root has only a few children, the list of filenames, the document and the index.
+    if (ya_cursor_first_child(&root, &child) != 1) {
+        return;
+    }
+    do {
+        last = child;
+    } while (ya_cursor_next_sibling(&child) == 1);
+
+    if (ya_cursor_type(&last) != YA_NODE_TYPE_INDEX || (data_size = ya_cursor_data_size(&last)) < sizeof (uint64_t)) {
+        return;
+    }
+    nr_nodes = ya_index_get64(ya_cursor_data(&last));
+    if (nr_nodes == 0 || nr_nodes > (data_size - sizeof (uint64_t)) / (sizeof (uint64_t) + 3 * sizeof (uint32_t))) {
+        return;
+    }
+
+    reader->index    = ya_cursor_data(&last);
+    reader->nr_nodes = nr_nodes;
+}
+
+/** Find the number of a node in the index.
+ * The offsets in the index are in depth first order, so they are sorted.
+ *
+ * @returns The number of the node, or UINT64_MAX when the node is not in the index.
+ */
+static uint64_t ya_index_find(const ya_reader_t *reader, const ya_cursor_t *cursor)
+{
+    uint64_t    offset = (const char *)cursor->node - reader->buf;
+    uint64_t    low = 0;
+    uint64_t    high = reader->nr_nodes;
+    uint64_t    middle;
+    uint64_t    middle_offset;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        middle_offset = ya_index_offset(reader, middle);
+        if (middle_offset == offset) {
+            return middle;
+        } else if (middle_offset < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return UINT64_MAX;
+}
+
+/** Point a cursor at a node of the index.
+ * The offsets in the index are checked like the sizes of the nodes.
+ */
+static int ya_index_cursor(const ya_reader_t *reader, uint64_t ordinal, const char *end, ya_cursor_t *cursor)
+{
+    uint64_t    offset = ya_index_offset(reader, ordinal);
+
+    if (offset >= (uint64_t)(end - reader->buf)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return ya_cursor_set(cursor, reader->buf + offset, end);
+}
+
+int ya_reader_node(const ya_reader_t *reader, uint64_t ordinal, ya_cursor_t *cursor)
+{
+    ya_cursor_t root;
+    ya_cursor_t parent;
+    ya_walker_t walker;
+    size_t      level;
+    uint32_t    parent_ordinal;
+    int         r;
+
+    if (reader->index != NULL) {
+        if (ordinal >= reader->nr_nodes) {
+            return 0;
+        }
+
+        // The siblings of the node end with its parent.
+        if ((parent_ordinal = ya_index_parent(reader, ordinal)) == UINT32_MAX) {
+            return ya_index_cursor(reader, ordinal, reader->buf + reader->size, cursor);
+        }
+        if (parent_ordinal >= reader->nr_nodes || ya_index_cursor(reader, parent_ordinal, reader->buf + reader->size, &parent) == -1) {
+            errno = EINVAL;
+            return -1;
+        }
+        return ya_index_cursor(reader, ordinal, (const char *)parent.node + ntohll(parent.node->size), cursor);
+    }
+
+    // Without an index, count the nodes until the requested node is found.
+    if (ya_reader_root(reader, &root) == -1 || ya_walker_init(&walker, &root) == -1) {
+        return -1;
+    }
+    while ((r = ya_walker_next(&walker, cursor, &level)) == 1 && ordinal > 0) {
+        ordinal--;
+    }
+    ya_walker_free(&walker);
+    return r;
+}
+
+int ya_cursor_child(const ya_reader_t *reader, const ya_cursor_t *parent, uint64_t n, ya_cursor_t *child)
+{
+    const char  *end = (const char *)parent->node + ntohll(parent->node->size);
+    uint64_t    ordinal;
+    uint32_t    first;
+    uint32_t    last;
+    int         r;
+
+    if (reader->index != NULL && (ordinal = ya_index_find(reader, parent)) != UINT64_MAX) {
+        first = ya_index_first_child(reader, ordinal);
+        last  = ya_index_first_child(reader, ordinal + 1);
+        if (first > last || last >= reader->nr_nodes) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (n >= last - first) {
+            return 0;
+        }
+        if ((ordinal = ya_index_child(reader, first + n)) >= reader->nr_nodes) {
+            errno = EINVAL;
+            return -1;
+        }
+        return ya_index_cursor(reader, ordinal, end, child);
+    }
+
+    // Without an index, skip the earlier siblings.
+    if ((r = ya_cursor_first_child(parent, child)) != 1) {
+        return r;
+    }
+    for (; n > 0; n--) {
+        if ((r = ya_cursor_next_sibling(child)) != 1) {
+            return r;
+        }
+    }
+    return 1;
+}
+
+const char *ya_cursor_text(const ya_cursor_t *cursor, size_t *length)
+{
+    *length = strnlen(cursor->node->data, ya_cursor_data_size(cursor));
+    return cursor->node->data;
+}
+
+int ya_cursor_uint64(const ya_cursor_t *cursor, uint64_t *value)
+{
+    uint64_t    tmp;
+
+    if (ya_cursor_data_size(cursor) != sizeof (tmp)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(&tmp, cursor->node->data, sizeof (tmp));
+    *value = ntohll(tmp);
+    return 0;
+}
+
+int ya_cursor_uint128(const ya_cursor_t *cursor, uint128_t *value)
+{
+    uint128_t   tmp;
+
+    if (ya_cursor_data_size(cursor) != sizeof (tmp)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(&tmp, cursor->node->data, sizeof (tmp));
+    *value = htonlll(tmp);
+    return 0;
+}
+
+/** Make sure the stack of a walker can hold one more level.
+ */
+static int ya_walker_reserve(ya_walker_t *walker)
+{
+    ya_cursor_t *stack;
+    size_t      capacity;
+
+    if (walker->depth < walker->capacity) {
+        return 0;
+    }
+
+    capacity = walker->capacity > 0 ? walker->capacity * 2 : 64;
+    if ((stack = realloc(walker->stack, capacity * sizeof (ya_cursor_t))) == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    walker->stack    = stack;
+    walker->capacity = capacity;
+    return 0;
+}
+
+int ya_walker_init(ya_walker_t *walker, const ya_cursor_t *root)
+{
+    walker->stack    = NULL;
+    walker->depth    = 0;
+    walker->capacity = 0;
+
+    if (ya_walker_reserve(walker) == -1) {
+        return -1;
+    }
+
+    // The root is visited without its siblings, so the end of its parent is the end of the root.
+    walker->stack[0].node = root->node;
+    walker->stack[0].end  = (const char *)root->node + ntohll(root->node->size);
+    walker->depth = 1;
+    return 0;
+}
+
+int ya_walker_next(ya_walker_t *walker, ya_cursor_t *cursor, size_t *level)
+{
+    ya_cursor_t *top;
+    ya_cursor_t child;
+    int         r;
+
+    // Drop the levels of which all nodes were visited.
+    while (walker->depth > 0 && walker->stack[walker->depth - 1].node == NULL) {
+        walker->depth--;
+    }
+    if (walker->depth == 0) {
+        return 0;
+    }
+
+    top = &walker->stack[walker->depth - 1];
+    *cursor = *top;
+    *level  = walker->depth - 1;
+
+    // The next sibling is visited after the children.
+    if ((r = ya_cursor_next_sibling(top)) == -1) {
+        return -1;
+    } else if (r == 0) {
+        top->node = NULL;
+    }
+
+    if ((r = ya_cursor_first_child(cursor, &child)) == -1) {
+        return -1;
+    } else if (r == 1) {
+        if (ya_walker_reserve(walker) == -1) {
+            return -1;
+        }
+        walker->stack[walker->depth++] = child;
+    }
+    return 1;
+}
+
+void ya_walker_free(ya_walker_t *walker)
+{
+    free(walker->stack);
+    walker->stack    = NULL;
+    walker->depth    = 0;
+    walker->capacity = 0;
+}
@@ -0,0 +1,242 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_READER_H
+#define YA_READER_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stddef.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <yyast/types.h>
+#include <yyast/utils.h>
+
+/** An AST file or buffer which is read in place.
+ * Nodes are not copied or converted, the fields of a node are converted to host byte order when
+ * they are accessed through a cursor.
+ */
+typedef struct {
+    const char      *buf;       ///< The AST, aligned to 64 bit.
+    size_t          size;       ///< Size of the AST in bytes.
+    int             mapped;     ///< The AST was mapped by ya_reader_open(), and is unmapped by ya_reader_close().
+    const char      *index;     ///< Data of the index node, or NULL when the AST has no index.
+    uint64_t        nr_nodes;   ///< Number of nodes in the index.
+} ya_reader_t;
+
+/** A node of an AST.
+ * A cursor points into the buffer of the reader and is only valid while the reader is open.
+ * It is small and may be copied freely.
+ */
+typedef struct {
+    const ya_node_t *node;      ///< Header of the node, as stored in the file.
+    const char      *end;       ///< End of the data of the parent, the siblings of the node are located before it.
+} ya_cursor_t;
+
+/** Walks over all nodes of a tree in depth first order.
+ * The walker keeps its own stack, so that deeply nested trees do not overflow the C stack.
+ */
+typedef struct {
+    ya_cursor_t     *stack;     ///< For each level, the next node to visit. A NULL node when the level is done.
+    size_t          depth;      ///< Number of levels on the stack.
+    size_t          capacity;   ///< Number of levels that fit in the stack.
+} ya_walker_t;
+
+/** Map an AST file in memory.
+ *
+ * @param reader    The reader to initialize.
+ * @param filename  Name of the AST file.
+ * @returns         0 on success, -1 on error with errno set.
+ */
+int ya_reader_open(ya_reader_t *reader, const char *filename);
+
+/* The index of a file is found by ya_reader_open() and ya_reader_init(), see YA_HEADER_FLAG_INDEX. */
+
+/** Read an AST from memory.
+ *
+ * @param reader    The reader to initialize.
+ * @param buf       The AST, which must be aligned to 64 bit and stay valid while the reader is used.
+ * @param size      Size of the AST in bytes.
+ * @returns         0 on success, -1 with errno set to EINVAL when the buffer is not aligned.
+ */
+int ya_reader_init(ya_reader_t *reader, const void *buf, size_t size);
+
+/** Release a reader.
+ * The file mapped by ya_reader_open() is unmapped, a buffer given to ya_reader_init() is left alone.
+ *
+ * @param reader    The reader to release.
+ */
+void ya_reader_close(ya_reader_t *reader);
+
+/** Get the root node of the AST.
+ *
+ * @param reader    An open reader.
+ * @param cursor    The cursor which is set to the root node.
+ * @returns         1 on success, -1 with errno set to EINVAL when the root node does not fit in the AST.
+ */
+int ya_reader_root(const ya_reader_t *reader, ya_cursor_t *cursor);
+
+/** Get a node by its number.
+ * Nodes are numbered in depth first order, the root is node 0. The index node is not numbered.
+ * When the AST has an index the node is found directly, otherwise the tree is walked.
+ *
+ * @param reader    An open reader.
+ * @param ordinal   The number of the node.
+ * @param cursor    The cursor which is set to the node.
+ * @returns         1 on success, 0 when there is no such node, -1 on error with errno set.
+ */
+int ya_reader_node(const ya_reader_t *reader, uint64_t ordinal, ya_cursor_t *cursor);
+
+/** Get the n-th child of a node.
+ * When the AST has an index the child is found directly, otherwise the earlier siblings are
+ * skipped. The index node is not a child of the root.
+ *
+ * @param reader    The reader of the parent.
+ * @param parent    The parent node.
+ * @param n         The number of the child, the first child is 0.
+ * @param child     The cursor which is set to the child.
+ * @returns         1 on success, 0 when there is no such child, -1 with errno set to EINVAL
+ *                  when the child does not fit in its parent.
+ */
+int ya_cursor_child(const ya_reader_t *reader, const ya_cursor_t *parent, uint64_t n, ya_cursor_t *child);
+
+/** Get the first child of a node.
+ * Only branches have children, the data of other nodes is not interpreted.
+ *
+ * @param parent    The parent node.
+ * @param child     The cursor which is set to the first child.
+ * @returns         1 when there is a child, 0 when there are no children, -1 with errno set
+ *                  to EINVAL when the child does not fit in its parent.
+ */
+int ya_cursor_first_child(const ya_cursor_t *parent, ya_cursor_t *child);
+
+/** Move to the next sibling of a node.
+ * The children of the node are skipped using its size, without reading them.
+ *
+ * @param cursor    The node, which is moved to its next sibling.
+ * @returns         1 when there is a next sibling, 0 when the node was the last child, -1 with
+ *                  errno set to EINVAL when the sibling does not fit in the parent.
+ */
+int ya_cursor_next_sibling(ya_cursor_t *cursor);
+
+/** Get the text of a text node.
+ * The text is not copied, the nul padding of the node is excluded from the length.
+ *
+ * @param cursor    A text node.
+ * @param length    The length of the text in bytes.
+ * @returns         The text, which is only nul terminated when its length is not a multiple of 8.
+ */
+const char *ya_cursor_text(const ya_cursor_t *cursor, size_t *length);
+
+/** Get the value of a node with 64 bit data, like an integer or a binary64 and decimal64 float.
+ *
+ * @param cursor    The node.
+ * @param value     The data in host byte order.
+ * @returns         0 on success, -1 with errno set to EINVAL when the data is not 64 bit.
+ */
+int ya_cursor_uint64(const ya_cursor_t *cursor, uint64_t *value);
+
+/** Get the value of a node with 128 bit data, like a binary128 and decimal128 float.
+ *
+ * @param cursor    The node.
+ * @param value     The data in host byte order.
+ * @returns         0 on success, -1 with errno set to EINVAL when the data is not 128 bit.
+ */
+int ya_cursor_uint128(const ya_cursor_t *cursor, uint128_t *value);
+
+/** Start walking a tree.
+ *
+ * @param walker    The walker to initialize.
+ * @param root      The first node to visit, its siblings are not visited.
+ * @returns         0 on success, -1 with errno set to ENOMEM when the stack can not be allocated.
+ */
+int ya_walker_init(ya_walker_t *walker, const ya_cursor_t *root);
+
+/** Visit the next node.
+ * Each node is visited before its children, and the children before the next sibling.
+ *
+ * @param walker    The walker.
+ * @param cursor    The cursor which is set to the visited node.
+ * @param level     The depth of the visited node, the root is at level 0.
+ * @returns         1 when a node was visited, 0 when all nodes were visited, -1 on error with
+ *                  errno set to EINVAL for a malformed node or ENOMEM when the stack can not grow.
+ */
+int ya_walker_next(ya_walker_t *walker, ya_cursor_t *cursor, size_t *level);
+
+/** Release the stack of a walker.
+ *
+ * @param walker    The walker to release.
+ */
+void ya_walker_free(ya_walker_t *walker);
+
+/** Name of a node.
+ */
+static inline ya_name_t ya_cursor_name(const ya_cursor_t *cursor)
+{
+    return ntohll(cursor->node->name);
+}
+
+/** Type of a node.
+ */
+static inline ya_type_t ya_cursor_type(const ya_cursor_t *cursor)
+{
+    return cursor->node->type;
+}
+
+/** Position of a node, unknown fields are UINT32_MAX.
+ */
+static inline ya_position_t ya_cursor_position(const ya_cursor_t *cursor)
+{
+    ya_position_t   position = {
+        .line   = ntohl(cursor->node->position.line),
+        .column = ntohl(cursor->node->position.column),
+        .file   = ntohl(cursor->node->position.file)
+    };
+
+    return position;
+}
+
+/** Flags of a node, only used in the root node.
+ */
+static inline uint16_t ya_cursor_flags(const ya_cursor_t *cursor)
+{
+    return ntohs(cursor->node->flags);
+}
+
+/** Size of the data of a node, including padding, excluding the header.
+ */
+static inline size_t ya_cursor_data_size(const ya_cursor_t *cursor)
+{
+    return ntohll(cursor->node->size) - sizeof (ya_node_t);
+}
+
+/** Data of a node, as stored in the file.
+ */
+static inline const char *ya_cursor_data(const ya_cursor_t *cursor)
+{
+    return cursor->node->data;
+}
+
+#endif
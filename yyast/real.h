@@ -0,0 +1,100 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_REAL_H
+#define YA_REAL_H
+
+#include <stddef.h>
+#include <yyast/types.h>
+#include <yyast/config.h>
+
+#if defined(HAVE_STRTOF128) || defined(HAVE_LIBQUADMATH)
+/** Defined when real literals can be converted to binary128.
+ */
+#define YA_HAVE_BINARY128 1
+#endif
+
+/** Result of converting a real literal.
+ */
+typedef enum {
+    YA_REAL_OK = 0,         ///< The literal was converted, correctly rounded.
+    YA_REAL_INVALID,        ///< The string does not start with a real literal.
+    YA_REAL_OVERFLOW,       ///< The literal is too large for the format.
+    YA_REAL_UNDERFLOW,      ///< The literal is not zero, but too small for the format.
+    YA_REAL_UNSUPPORTED,    ///< The format is not supported on this platform.
+} ya_real_status_t;
+
+/** Convert a real literal to a binary64 floating point number.
+ *
+ * The conversion does not depend on the locale and does not need a nul terminated string.
+ * A literal has the form: [+-] digits [. digits] [e [+-] digits], "inf", "infinity" or "nan".
+ * Hexadecimal literals, with a binary exponent "p", are converted when base is 16 or
+ * when the literal starts with "0x". Characters after the literal are ignored.
+ *
+ * Most literals are converted with the Eisel-Lemire algorithm, only literals that are
+ * very close to half way between two floating point numbers fall back to strtod().
+ *
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param base      The base of the literal, 10 or 16.
+ * @param value     The converted floating point number.
+ * @returns         Status of the conversion.
+ */
+ya_real_status_t ya_real64(const char * restrict buf, size_t buf_size, int base, double * restrict value);
+
+/** Convert a real literal to a binary128 floating point number.
+ * Literals are parsed the same way as ya_real64().
+ *
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param base      The base of the literal, 10 or 16.
+ * @param value     The IEEE 754 binary128 bit pattern of the converted number, in host byte order.
+ * @returns         Status of the conversion, YA_REAL_UNSUPPORTED when YA_HAVE_BINARY128 is not defined.
+ */
+ya_real_status_t ya_real128(const char * restrict buf, size_t buf_size, int base, uint128_t * restrict value);
+
+/** Convert a decimal literal to a decimal64 floating point number in the binary integer decimal (BID) encoding.
+ *
+ * The literal is parsed the same way as ya_real64(), but only in base 10. The coefficient and
+ * exponent are kept as written, so "1.50" is encoded as 150e-2. Literals with more than 16
+ * significant digits are rounded half to even.
+ *
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param value     The decimal64 bit pattern of the converted number, in host byte order.
+ * @returns         Status of the conversion.
+ */
+ya_real_status_t ya_decimal64(const char * restrict buf, size_t buf_size, uint64_t * restrict value);
+
+/** Convert a decimal literal to a decimal128 floating point number in the binary integer decimal (BID) encoding.
+ * Literals are parsed the same way as ya_decimal64(), and rounded to 34 significant digits.
+ *
+ * @param buf       Literal as string.
+ * @param buf_size  String size.
+ * @param value     The decimal128 bit pattern of the converted number, in host byte order.
+ * @returns         Status of the conversion.
+ */
+ya_real_status_t ya_decimal128(const char * restrict buf, size_t buf_size, uint128_t * restrict value);
+
+#endif
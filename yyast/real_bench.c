@@ -0,0 +1,166 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <yyast/real.h>
+
+/** Number of literals to convert.
+ */
+#define NR_LITERALS     (1024 * 1024)
+
+/** Number of times the literals are converted.
+ */
+#define NR_ITERATIONS   5
+
+/** Size of the buffer holding a single literal.
+ */
+#define LITERAL_SIZE    32
+
+typedef double (*convert_function_t)(const char *s, size_t s_length);
+
+/** Fill a buffer with nul terminated literals of the sort found in numerical tables.
+ * Short fixed point numbers, numbers with many digits and numbers with exponents.
+ */
+void fill_literals(char *literals)
+{
+    size_t  i;
+    double  d;
+
+    srand(42);
+    for (i = 0; i < NR_LITERALS; i++) {
+        d = (double)rand() / RAND_MAX;
+        switch (rand() % 4) {
+        case 0: snprintf(&literals[i * LITERAL_SIZE], LITERAL_SIZE, "%.3f", d * 1000.0); break;
+        case 1: snprintf(&literals[i * LITERAL_SIZE], LITERAL_SIZE, "%.17g", d); break;
+        case 2: snprintf(&literals[i * LITERAL_SIZE], LITERAL_SIZE, "%.6e", d * 1e10); break;
+        case 3: snprintf(&literals[i * LITERAL_SIZE], LITERAL_SIZE, "%.16fe%i", d, rand() % 600 - 300); break;
+        }
+    }
+}
+
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** The conversion used by ya_binary_float() before ya_real64().
+ */
+double convert_strtold(const char *s, size_t s_length)
+{
+    return strtold(s, NULL);
+}
+
+/** Correctly rounded conversion of the C library.
+ */
+double convert_strtod(const char *s, size_t s_length)
+{
+    return strtod(s, NULL);
+}
+
+double convert_real64(const char *s, size_t s_length)
+{
+    double  value;
+
+    ya_real64(s, s_length, 10, &value);
+    return value;
+}
+
+/** Convert all literals.
+ */
+void convert(convert_function_t function, const char *literals, const size_t *sizes, double *values, double *seconds)
+{
+    size_t  i;
+    int     iteration;
+    double  start = now();
+
+    for (iteration = 0; iteration < NR_ITERATIONS; iteration++) {
+        for (i = 0; i < NR_LITERALS; i++) {
+            values[i] = function(&literals[i * LITERAL_SIZE], sizes[i]);
+        }
+    }
+
+    *seconds = now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    struct {
+        const char          *name;
+        convert_function_t  function;
+    } implementations[] = {
+        {"strtod",  convert_strtod},
+        {"strtold", convert_strtold},
+        {"real64",  convert_real64},
+    };
+    char            *literals = malloc(NR_LITERALS * LITERAL_SIZE);
+    size_t          *sizes = malloc(NR_LITERALS * sizeof (size_t));
+    double          *expected = malloc(NR_LITERALS * sizeof (double));
+    double          *values = malloc(NR_LITERALS * sizeof (double));
+    size_t          nr_bytes = 0;
+    size_t          nr_differences;
+    double          seconds;
+    size_t          i;
+    size_t          j;
+    int             r = 0;
+
+    fill_literals(literals);
+    for (i = 0; i < NR_LITERALS; i++) {
+        sizes[i] = strlen(&literals[i * LITERAL_SIZE]);
+        nr_bytes+= sizes[i];
+    }
+
+    for (j = 0; j < sizeof (implementations) / sizeof (implementations[0]); j++) {
+        convert(implementations[j].function, literals, sizes, j == 0 ? expected : values, &seconds);
+
+        // strtod() is the reference, strtold() is rounded twice so it may differ.
+        nr_differences = 0;
+        for (i = 0; j > 0 && i < NR_LITERALS; i++) {
+            nr_differences+= memcmp(&values[i], &expected[i], sizeof (double)) != 0;
+        }
+        if (j > 0 && nr_differences > 0 && implementations[j].function == convert_real64) {
+            fprintf(stderr, "%s: %zu literals differ from strtod\n", implementations[j].name, nr_differences);
+            r = 1;
+        }
+
+        fprintf(stdout, "%-8s %8.1f MB/s %8.1f Mliterals/s %6zu differ from strtod\n",
+            implementations[j].name,
+            (double)nr_bytes * NR_ITERATIONS / seconds / 1e6,
+            (double)NR_LITERALS * NR_ITERATIONS / seconds / 1e6,
+            nr_differences
+        );
+    }
+
+    free(values);
+    free(expected);
+    free(sizes);
+    free(literals);
+    return r;
+}
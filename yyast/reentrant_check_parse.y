@@ -0,0 +1,59 @@
+%{
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* The pure parser of the reentrant check, which makes a list of the words of its input.
+ * It follows the reentrant recipe of the documentation.
+ */
+#define YA_REENTRANT
+#include <yyast/yyast.h>
+
+int yylex(YYSTYPE *yylval_param, void *scanner);
+void yyerror(void *scanner, const char *message);
+%}
+
+%define api.pure
+%lex-param {void *scanner}
+%parse-param {void *scanner}
+
+%token WORD
+
+%%
+
+document
+    : words                         { ya_t document = YA_BRANCH("words", &$1); ya_start = YA_HEADER(&document); }
+    ;
+
+words
+    : /* empty */                   { $$ = YA_EMPTYLIST; }
+    | words WORD                    { $$ = YA_LIST(&$1, &$2); }
+    ;
+
+%%
+
+void yyerror(void *scanner, const char *message)
+{
+    ya_error("%s", message);
+}
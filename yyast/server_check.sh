@@ -0,0 +1,17 @@
+#!/bin/sh
+# Parse two files with a single server which scans its input in place with -m. Each request
+# must scan its own file, and not the requests which the server reads from stdin.
+set -e
+
+dir=`mktemp -d`
+trap 'rm -rf "$dir"' EXIT
+
+printf 'alpha beta\n' > "$dir/a.txt"
+printf 'gamma delta epsilon\n' > "$dir/b.txt"
+./server_check -o "$dir/a.expected.ast" "$dir/a.txt"
+./server_check -o "$dir/b.expected.ast" "$dir/b.txt"
+
+printf '%s\n%s\n\n' "$dir/a.txt" "$dir/b.txt" | ./server_check -m -S - > "$dir/replies"
+printf 'ok\nok\n' | cmp - "$dir/replies"
+cmp "$dir/a.expected.ast" "$dir/a.ast"
+cmp "$dir/b.expected.ast" "$dir/b.ast"
@@ -25,7 +25,9 @@
 #ifndef YA_TYPES_H
 #define YA_TYPES_H
 
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -48,8 +50,10 @@ typedef uint8_t  ya_type_t;
 #define YA_NODE_TYPE_POSITIVE_INTEGER  4    ///< Positive integer, encoded as a big endian unsigned integer.
 #define YA_NODE_TYPE_NEGATIVE_INTEGER  5    ///< Negative integer, encoded as a big endian unsigned integer.
 #define YA_NODE_TYPE_BINARY_FLOAT      6    ///< Binary floating point, encoded as a 'big endian' binary64 or binary128 IEEE-754.
-#define YA_NODE_TYPE_DECIMAL_FLOAT     7    ///< Decimal floating point, encoded as a 'big endian' decimal64 or decimal128 IEEE-754.
+#define YA_NODE_TYPE_DECIMAL_FLOAT     7    ///< Decimal floating point, encoded as a 'big endian' decimal64 or decimal128 IEEE-754, using binary integer decimal.
+#define YA_NODE_TYPE_INDEX             8    ///< Offset index of the nodes in the file, see ya_index_build().
 
+#define YA_NODE_TYPE_SPOOL             253  ///< Serialized nodes which are stored in the spool file. Never encoded in the output file.
 #define YA_NODE_TYPE_LIST              254  ///< List node which links child lists together. Never encoded in the output file.
 #define YA_NODE_TYPE_COUNT             255  ///< Count node, which is never encoded in the output file.
 
@@ -70,13 +74,18 @@ struct ya_node_s {
     ya_name_t           name;       ///< Name of the node.
     uint64_t            size;       ///< Size of the node, including header and data. Always 64 bit aligned.
     ya_position_t       position;   ///< The position of the node.
-    uint16_t            reserved_1; ///< Reserved, must be zero.
+    uint16_t            flags;      ///< Flags of the file, see YA_HEADER_FLAG_UTF8. Only used in the root node, zero in other nodes.
     uint8_t             reserved_2; ///< Reserved, must be zero.
     ya_type_t           type;       ///< Type of node.
     char                data[];     ///< Data aligned to 64 bit and sized to 64 bit. Includes padding zero bytes at the end.
 } __attribute__((packed, aligned(8)));
 typedef struct ya_node_s ya_node_t;
 
+/** Children of a branch or list which has not been serialized yet.
+ * See ya_deferred in node.h.
+ */
+typedef struct ya_tree_s ya_tree_t;
+
 /** Structure to pass around on the stack for the parser.
  * Passing this whole structure around the stack makes it easier for the user of this library.
  */
@@ -84,10 +93,46 @@ typedef struct {
     uint64_t        size;       //< Size including header and padding.
     ya_position_t   position;   //< Position where the start of the node is located in the source file.
     ya_type_t       type;       //< The type of node.
-    ya_node_t       *node;      //< The complete data, including the header.
+    uint8_t         shared;     //< The node is a shared leaf template, which must not be modified or free-ed.
+    ya_node_t       *node;      //< The complete data, including the header. NULL when the node is deferred.
+    ya_tree_t       *tree;      //< The children of a deferred branch or list, NULL when the node is serialized.
 } ya_t;
 
-extern ya_t ya_start;
+/** A deferred branch or list.
+ * Only references to the children are recorded, the children are serialized
+ * once when the complete tree is saved.
+ */
+struct ya_tree_s {
+    ya_name_t       name;           ///< Name of the node, in host byte order.
+    ya_position_t   position;       ///< Position written in the header, which may differ from the position in ya_t.
+    uint64_t        spool_offset;   ///< Offset in the spool file of a YA_NODE_TYPE_SPOOL node.
+    uint64_t        spooled_size;   ///< Number of bytes of the children of a list which are in the spool file.
+    uint16_t        flags;          ///< Flags written in the header, in host byte order.
+    size_t          nr_children;    ///< Number of children.
+    size_t          capacity;       ///< Number of children that fit in the allocation.
+    ya_t            children[];     ///< The children, lists are already expanded.
+};
+
+/** Shared templates of leaves, by name.
+ * See ya_shared_leaf() in leaf.h.
+ */
+typedef struct {
+    ya_node_t   **table;            ///< Hash table with templates, NULL for an empty slot.
+    uint32_t    nr_templates;       ///< Number of templates.
+    uint32_t    table_size;         ///< Number of slots in the hash table, a power of two.
+} ya_leaf_templates_t;
+
+/** Registry of source filenames.
+ * Each filename is stored once, and found through a hash table.
+ */
+typedef struct {
+    char        **filenames;        ///< Filenames in the order they were added, the index is the file number.
+    size_t      *lengths;           ///< Length of each filename.
+    uint32_t    nr_filenames;       ///< Number of filenames.
+    uint32_t    capacity;           ///< Number of filenames that fit in filenames and lengths.
+    uint32_t    *table;             ///< Hash table with file numbers, UINT32_MAX for an empty slot.
+    uint32_t    table_size;         ///< Number of slots in the hash table, a power of two.
+} ya_filenames_t;
 
 /** Lex and Yacc needs to know what type should be used. To pass tokens and nodes around.
  */
@@ -0,0 +1,319 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdint.h>
+#include <yyast/utf8.h>
+
+#ifdef YA_COUNT_X86
+#include <immintrin.h>
+#endif
+
+size_t ya_utf8_validate_scalar(const char *s, size_t s_length)
+{
+    const uint8_t   *p = (const uint8_t *)s;
+    size_t          i = 0;
+    size_t          nr_continuations;
+    size_t          k;
+    uint64_t        block;
+    uint8_t         c;
+    uint8_t         low;
+    uint8_t         high;
+
+    while (i < s_length) {
+        // Skip ASCII eight bytes at a time.
+        if (i + 8 <= s_length) {
+            memcpy(&block, &p[i], sizeof (block));
+            if ((block & 0x8080808080808080ULL) == 0) {
+                i+= 8;
+                continue;
+            }
+        }
+
+        if ((c = p[i]) < 0x80) {
+            i++;
+            continue;
+        }
+
+        // Lead bytes 0x80-0xc1 are continuations or overlong, above 0xf4 is beyond U+10FFFF.
+        if (c < 0xc2 || c > 0xf4) {
+            return i;
+        }
+        nr_continuations = c < 0xe0 ? 1 : c < 0xf0 ? 2 : 3;
+        if (s_length - i <= nr_continuations) {
+            return i;
+        }
+
+        // The range of the second byte excludes overlong encodings, surrogates and code points above U+10FFFF.
+        low  = c == 0xe0 ? 0xa0 : c == 0xf0 ? 0x90 : 0x80;
+        high = c == 0xed ? 0x9f : c == 0xf4 ? 0x8f : 0xbf;
+        if (p[i + 1] < low || p[i + 1] > high) {
+            return i;
+        }
+        for (k = 2; k <= nr_continuations; k++) {
+            if ((p[i + k] & 0xc0) != 0x80) {
+                return i;
+            }
+        }
+        i+= nr_continuations + 1;
+    }
+    return i;
+}
+
+#ifdef YA_COUNT_X86
+/* The vector implementations use the lookup algorithm of John Keiser and Daniel Lemire,
+ * "Validating UTF-8 In Less Than One Instruction Per Byte", Software: Practice and Experience, 2021.
+ *
+ * Each pair of bytes is classified by three table lookups, on the high and low nibble of the
+ * first byte and the high nibble of the second byte. Each bit of the result is an error that
+ * is only possible when all three lookups agree. Two or three byte continuations are checked
+ * separately from the bytes two and three positions earlier.
+ */
+#define YA_UTF8_TOO_SHORT       (1 << 0)    ///< 11______ 0_______ or 11______ 11______
+#define YA_UTF8_TOO_LONG        (1 << 1)    ///< 0_______ 10______
+#define YA_UTF8_OVERLONG_3      (1 << 2)    ///< 11100000 100_____
+#define YA_UTF8_TOO_LARGE       (1 << 3)    ///< 11110100 1001____, 11110100 101_____, 11110101-11111111 10______
+#define YA_UTF8_SURROGATE       (1 << 4)    ///< 11101101 101_____
+#define YA_UTF8_OVERLONG_2      (1 << 5)    ///< 1100000_ 10______
+#define YA_UTF8_TOO_LARGE_1000  (1 << 6)    ///< 11110101-11111111 1000____
+#define YA_UTF8_OVERLONG_4      (1 << 6)    ///< 11110000 1000____
+#define YA_UTF8_TWO_CONTS       (1 << 7)    ///< 10______ 10______
+#define YA_UTF8_CARRY           (YA_UTF8_TOO_SHORT | YA_UTF8_TOO_LONG | YA_UTF8_TWO_CONTS)
+
+/** Errors by the high nibble of the first byte.
+ */
+static const uint8_t ya_utf8_byte_1_high[16] = {
+    YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG,
+    YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG, YA_UTF8_TOO_LONG,
+    YA_UTF8_TWO_CONTS, YA_UTF8_TWO_CONTS, YA_UTF8_TWO_CONTS, YA_UTF8_TWO_CONTS,
+    YA_UTF8_TOO_SHORT | YA_UTF8_OVERLONG_2,
+    YA_UTF8_TOO_SHORT,
+    YA_UTF8_TOO_SHORT | YA_UTF8_OVERLONG_3 | YA_UTF8_SURROGATE,
+    YA_UTF8_TOO_SHORT | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000 | YA_UTF8_OVERLONG_4
+};
+
+/** Errors by the low nibble of the first byte.
+ */
+static const uint8_t ya_utf8_byte_1_low[16] = {
+    YA_UTF8_CARRY | YA_UTF8_OVERLONG_3 | YA_UTF8_OVERLONG_2 | YA_UTF8_OVERLONG_4,
+    YA_UTF8_CARRY | YA_UTF8_OVERLONG_2,
+    YA_UTF8_CARRY,
+    YA_UTF8_CARRY,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000 | YA_UTF8_SURROGATE,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000,
+    YA_UTF8_CARRY | YA_UTF8_TOO_LARGE | YA_UTF8_TOO_LARGE_1000
+};
+
+/** Errors by the high nibble of the second byte.
+ */
+static const uint8_t ya_utf8_byte_2_high[16] = {
+    YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT,
+    YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT,
+    YA_UTF8_TOO_LONG | YA_UTF8_OVERLONG_2 | YA_UTF8_TWO_CONTS | YA_UTF8_OVERLONG_3 | YA_UTF8_TOO_LARGE_1000 | YA_UTF8_OVERLONG_4,
+    YA_UTF8_TOO_LONG | YA_UTF8_OVERLONG_2 | YA_UTF8_TWO_CONTS | YA_UTF8_OVERLONG_3 | YA_UTF8_TOO_LARGE,
+    YA_UTF8_TOO_LONG | YA_UTF8_OVERLONG_2 | YA_UTF8_TWO_CONTS | YA_UTF8_SURROGATE  | YA_UTF8_TOO_LARGE,
+    YA_UTF8_TOO_LONG | YA_UTF8_OVERLONG_2 | YA_UTF8_TWO_CONTS | YA_UTF8_SURROGATE  | YA_UTF8_TOO_LARGE,
+    YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT, YA_UTF8_TOO_SHORT
+};
+
+/** Maximum of the bytes at the end of a block which do not start a sequence that continues in the next block.
+ * A 16 byte block uses the last 16 entries.
+ */
+static const uint8_t ya_utf8_incomplete_tail[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf
+};
+
+__attribute__((target("ssse3")))
+size_t ya_utf8_validate_ssse3(const char *s, size_t s_length)
+{
+    const __m128i   byte_1_high_table = _mm_loadu_si128((const __m128i *)ya_utf8_byte_1_high);
+    const __m128i   byte_1_low_table = _mm_loadu_si128((const __m128i *)ya_utf8_byte_1_low);
+    const __m128i   byte_2_high_table = _mm_loadu_si128((const __m128i *)ya_utf8_byte_2_high);
+    const __m128i   incomplete_tail = _mm_loadu_si128((const __m128i *)&ya_utf8_incomplete_tail[16]);
+    const __m128i   nibble = _mm_set1_epi8(0x0f);
+    __m128i         error = _mm_setzero_si128();
+    __m128i         previous = _mm_setzero_si128();
+    __m128i         previous_incomplete = _mm_setzero_si128();
+    __m128i         v;
+    __m128i         prev1;
+    __m128i         special_cases;
+    __m128i         must_be_continuation;
+    char            tail[16];
+    size_t          i;
+
+    for (i = 0; i < s_length; i+= 16) {
+        if (i + 16 <= s_length) {
+            v = _mm_loadu_si128((const __m128i *)&s[i]);
+        } else {
+            // Pad the last block with ASCII nul characters.
+            memset(tail, 0, sizeof (tail));
+            memcpy(tail, &s[i], s_length - i);
+            v = _mm_loadu_si128((const __m128i *)tail);
+        }
+
+        if (_mm_movemask_epi8(v) == 0) {
+            // An ASCII block is only an error when the previous block ended in the middle of a sequence.
+            error = _mm_or_si128(error, previous_incomplete);
+        } else {
+            prev1 = _mm_alignr_epi8(v, previous, 15);
+            special_cases = _mm_and_si128(_mm_and_si128(
+                _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble))
+            );
+
+            // Only the third byte after 111_____ and the fourth byte after 1111____ must be continuations.
+            must_be_continuation = _mm_and_si128(_mm_or_si128(
+                _mm_subs_epu8(_mm_alignr_epi8(v, previous, 14), _mm_set1_epi8(0xe0 - 0x80)),
+                _mm_subs_epu8(_mm_alignr_epi8(v, previous, 13), _mm_set1_epi8(0xf0 - 0x80))),
+                _mm_set1_epi8((char)0x80)
+            );
+
+            error = _mm_or_si128(error, _mm_xor_si128(must_be_continuation, special_cases));
+            previous_incomplete = _mm_subs_epu8(v, incomplete_tail);
+        }
+        previous = v;
+    }
+    error = _mm_or_si128(error, previous_incomplete);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff) {
+        return s_length;
+    }
+    // Find the offset of the error.
+    return ya_utf8_validate_scalar(s, s_length);
+}
+
+__attribute__((target("avx2")))
+size_t ya_utf8_validate_avx2(const char *s, size_t s_length)
+{
+    // The shuffles look up each 128 bit lane separately, so both lanes hold the same table.
+    const __m256i   byte_1_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ya_utf8_byte_1_high));
+    const __m256i   byte_1_low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ya_utf8_byte_1_low));
+    const __m256i   byte_2_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ya_utf8_byte_2_high));
+    const __m256i   incomplete_tail = _mm256_loadu_si256((const __m256i *)ya_utf8_incomplete_tail);
+    const __m256i   nibble = _mm256_set1_epi8(0x0f);
+    __m256i         error = _mm256_setzero_si256();
+    __m256i         previous = _mm256_setzero_si256();
+    __m256i         previous_incomplete = _mm256_setzero_si256();
+    __m256i         v;
+    __m256i         shifted;
+    __m256i         prev1;
+    __m256i         special_cases;
+    __m256i         must_be_continuation;
+    char            tail[32];
+    size_t          i;
+
+    for (i = 0; i < s_length; i+= 32) {
+        if (i + 32 <= s_length) {
+            v = _mm256_loadu_si256((const __m256i *)&s[i]);
+        } else {
+            // Pad the last block with ASCII nul characters.
+            memset(tail, 0, sizeof (tail));
+            memcpy(tail, &s[i], s_length - i);
+            v = _mm256_loadu_si256((const __m256i *)tail);
+        }
+
+        if (_mm256_movemask_epi8(v) == 0) {
+            // An ASCII block is only an error when the previous block ended in the middle of a sequence.
+            error = _mm256_or_si256(error, previous_incomplete);
+        } else {
+            // The byte alignment works on each 128 bit lane, shifted holds the high lane of previous and the low lane of v.
+            shifted = _mm256_permute2x128_si256(previous, v, 0x21);
+            prev1 = _mm256_alignr_epi8(v, shifted, 15);
+            special_cases = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble))
+            );
+
+            // Only the third byte after 111_____ and the fourth byte after 1111____ must be continuations.
+            must_be_continuation = _mm256_and_si256(_mm256_or_si256(
+                _mm256_subs_epu8(_mm256_alignr_epi8(v, shifted, 14), _mm256_set1_epi8(0xe0 - 0x80)),
+                _mm256_subs_epu8(_mm256_alignr_epi8(v, shifted, 13), _mm256_set1_epi8(0xf0 - 0x80))),
+                _mm256_set1_epi8((char)0x80)
+            );
+
+            error = _mm256_or_si256(error, _mm256_xor_si256(must_be_continuation, special_cases));
+            previous_incomplete = _mm256_subs_epu8(v, incomplete_tail);
+        }
+        previous = v;
+    }
+    error = _mm256_or_si256(error, previous_incomplete);
+
+    if (_mm256_testz_si256(error, error)) {
+        return s_length;
+    }
+    // Find the offset of the error.
+    return ya_utf8_validate_scalar(s, s_length);
+}
+#endif
+
+/** Select the fastest implementation the first time it is called.
+ * Parsers on different threads may race to select it, they all store the same function.
+ */
+static size_t ya_utf8_validate_dispatch(const char *s, size_t s_length);
+
+static size_t (*ya_utf8_validate_implementation)(const char *s, size_t s_length) = ya_utf8_validate_dispatch;
+
+static size_t ya_utf8_validate_dispatch(const char *s, size_t s_length)
+{
+    size_t (*implementation)(const char *s, size_t s_length);
+
+#ifdef YA_COUNT_X86
+    if (__builtin_cpu_supports("avx2")) {
+        implementation = ya_utf8_validate_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        implementation = ya_utf8_validate_ssse3;
+    } else {
+        implementation = ya_utf8_validate_scalar;
+    }
+#else
+    implementation = ya_utf8_validate_scalar;
+#endif
+
+    __atomic_store_n(&ya_utf8_validate_implementation, implementation, __ATOMIC_RELAXED);
+    return implementation(s, s_length);
+}
+
+size_t ya_utf8_validate(const char *s, size_t s_length)
+{
+    if (s_length < 16) {
+        // Most tokens are short, the vector implementations only help on long tokens.
+        return ya_utf8_validate_scalar(s, s_length);
+    } else {
+        return __atomic_load_n(&ya_utf8_validate_implementation, __ATOMIC_RELAXED)(s, s_length);
+    }
+}
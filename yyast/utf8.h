@@ -0,0 +1,58 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_UTF8_H
+#define YA_UTF8_H
+
+#include <stddef.h>
+#include <yyast/count.h>
+
+/** Validate UTF-8 text.
+ * Overlong encodings, surrogates, code points above U+10FFFF and truncated
+ * sequences are invalid. A vector implementation is selected at runtime for long texts.
+ *
+ * @param s         The text to validate.
+ * @param s_length  The length of the text in bytes.
+ * @returns         The offset of the first invalid sequence, or s_length when the text is valid.
+ */
+size_t ya_utf8_validate(const char *s, size_t s_length);
+
+/** Validate UTF-8 text one code point at a time.
+ * See ya_utf8_validate().
+ */
+size_t ya_utf8_validate_scalar(const char *s, size_t s_length);
+
+#ifdef YA_COUNT_X86
+/** Validate UTF-8 text 16 bytes at a time.
+ * Only call this when the CPU supports SSSE3. See ya_utf8_validate().
+ */
+size_t ya_utf8_validate_ssse3(const char *s, size_t s_length);
+
+/** Validate UTF-8 text 32 bytes at a time.
+ * Only call this when the CPU supports AVX2. See ya_utf8_validate().
+ */
+size_t ya_utf8_validate_avx2(const char *s, size_t s_length);
+#endif
+
+#endif
@@ -42,6 +42,8 @@ size_t ya_string_escape(uint8_t *string, size_t string_size, int raw)
     int             base = 0;
     int             count = 0;
     int32_t         code_point = 0;
+    uint8_t         *next;
+    size_t          run;
 
     for (i = 0, j = 0; i < string_size; i++) {
         c = string[i];
@@ -89,7 +91,6 @@ size_t ya_string_escape(uint8_t *string, size_t string_size, int raw)
                 } else {
                     ya_error("Could not encode code point %lli.", (long long)code_point);
                 }
-                string[j++] = code_point;
             }
 
         } else if (escape) {
@@ -127,7 +128,14 @@ size_t ya_string_escape(uint8_t *string, size_t string_size, int raw)
             escape = 1;
 
         } else {
-            string[j++] = c;
+            // Most of a string has no escapes, copy everything up to the next escape character at once.
+            next = memchr(&string[i], '\\', string_size - i);
+            run = (next != NULL ? (size_t)(next - &string[i]) : string_size - i);
+            if (j != i) {
+                memmove(&string[j], &string[i], run);
+            }
+            j+= run;
+            i+= run - 1;
         }
     }
 
@@ -25,7 +25,9 @@
 #ifndef YA_UTILS_H
 #define YA_UTILS_H
 
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdlib.h>
 #include <stdint.h>
 #include <yyast/types.h>
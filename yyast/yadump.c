@@ -24,12 +24,11 @@
  */
 #define _GNU_SOURCE
 #include <unistd.h>
-#include <fcntl.h>
 #include <string.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 #include <arpa/inet.h>
+#include <errno.h>
 #include <yyast/yyast.h>
+#include <yyast/reader.h>
 
 typedef union {
     int64_t     i;
@@ -61,30 +60,66 @@ void print_name(ya_name_t name)
     );
 }
 
-off_t node_decode(char *buf, size_t buf_size, unsigned int level)
+/** Print a decimal64 or decimal128 in the binary integer decimal encoding, as coefficient and exponent.
+ * @param bits          The bit pattern of the number, the sign bit is the most significant bit.
+ * @param nr_bits       64 or 128.
+ */
+void print_decimal(uint128_t bits, int nr_bits)
 {
-    if (buf_size < sizeof (ya_node_t)) {
-        fprintf(stdout, "!error size to small to decode header.\n");
-        exit(1);
+    int             exponent_bits = nr_bits == 64 ? 10 : 14;
+    int             coefficient_bits = nr_bits == 64 ? 53 : 113;
+    int             bias = nr_bits == 64 ? 398 : 6176;
+    int             sign = (bits >> (nr_bits - 1)) & 1;
+    int             combination = (bits >> (nr_bits - 6)) & 0x1f;
+    uint128_t       coefficient;
+    uint128_t       max_coefficient = nr_bits == 64 ? 10000000000000000ULL : (uint128_t)10000000000000000ULL * 10000000000000000ULL * 100;
+    int             exponent;
+    char            digits[40];
+    int             i = sizeof (digits);
+
+    if (combination == 0x1f) {
+        fprintf(stdout, " %snan\n", sign ? "-" : "");
+        return;
+    } else if (combination == 0x1e) {
+        fprintf(stdout, " %sinf\n", sign ? "-" : "");
+        return;
     }
 
-    ya_node_t           *node = (ya_node_t *)buf;
-    ya_name_t           name = ntohll(node->name);
-    ya_type_t           type = node->type;
-    ya_position_t       position = {.file = ntohl(node->position.file), .line = ntohl(node->position.line), .column = ntohl(node->position.column)};
-    size_t              inner_size = ntohll(node->size) - sizeof (ya_node_t);
-    off_t               inner_offset = 0;
-    type64_t            t64;
-    char                *s;
-
-    if (inner_size > buf_size) {
-        // We use stdout, so that the error is synchronized to the output data.
-        fprintf(stdout, "!error inner_size (%llu) larger than buffer_size (%llu)\n",
-            (unsigned long long)inner_size,
-            (unsigned long long)buf_size
-        );
-        exit(1);
+    if (((bits >> (nr_bits - 3)) & 3) == 3) {
+        // Large coefficients have an implicit 0b100 prefix.
+        exponent = (bits >> (coefficient_bits - 2)) & ((1 << exponent_bits) - 1);
+        coefficient = (bits & (((uint128_t)1 << (coefficient_bits - 2)) - 1)) | ((uint128_t)1 << coefficient_bits);
+    } else {
+        exponent = (bits >> coefficient_bits) & ((1 << exponent_bits) - 1);
+        coefficient = bits & (((uint128_t)1 << coefficient_bits) - 1);
     }
+    if (coefficient >= max_coefficient) {
+        // Non-canonical coefficients are interpreted as zero.
+        coefficient = 0;
+    }
+
+    digits[--i] = 0;
+    do {
+        digits[--i] = '0' + coefficient % 10;
+        coefficient/= 10;
+    } while (coefficient > 0);
+
+    fprintf(stdout, " %s%se%i\n", sign ? "-" : "", &digits[i], exponent - bias);
+}
+
+/** Print a node on a single line.
+ * @param cursor        The node to print.
+ * @param level         The depth of the node in the tree.
+ */
+void print_node(const ya_cursor_t *cursor, size_t level)
+{
+    ya_type_t           type = ya_cursor_type(cursor);
+    ya_position_t       position = ya_cursor_position(cursor);
+    size_t              inner_size = ya_cursor_data_size(cursor);
+    type64_t            t64;
+    uint128_t           t128;
+    const char          *s;
+    size_t              s_length;
 
     if (position.file != UINT32_MAX) {
         fprintf(stdout, "%2lu:%4lu:%3lu", (long)position.file, (long)position.line, (long)position.column);
@@ -96,100 +131,118 @@ off_t node_decode(char *buf, size_t buf_size, unsigned int level)
 
     indent(level);
     fprintf(stdout, " ");
-    print_name(name);
+    print_name(ya_cursor_name(cursor));
 
     switch (type) {
     case YA_NODE_TYPE_POSITIVE_INTEGER:
-        if (inner_size == sizeof (t64)) {
-            memcpy(t64.c, node->data, sizeof (t64));
-            t64.u = ntohll(t64.u);
+        if (ya_cursor_uint64(cursor, &t64.u) == 0) {
             fprintf(stdout, " +%lli\n", (long long int)t64.i);
         } else {
             fprintf(stdout, " +i%i\n", (int)inner_size);
         }
         break;
     case YA_NODE_TYPE_NEGATIVE_INTEGER:
-        if (inner_size == sizeof (t64)) {
-            memcpy(t64.c, node->data, sizeof (t64));
-            t64.u = ntohll(t64.u);
+        if (ya_cursor_uint64(cursor, &t64.u) == 0) {
             fprintf(stdout, " -%llu\n", (long long unsigned)t64.u);
         } else {
             fprintf(stdout, " -i%i\n", (int)inner_size);
         }
         break;
     case YA_NODE_TYPE_BINARY_FLOAT:
-        if (inner_size == sizeof (t64)) {
-            memcpy(t64.c, node->data, sizeof (t64));
-            t64.u = ntohll(t64.u);
+        if (ya_cursor_uint64(cursor, &t64.u) == 0) {
             fprintf(stdout, " %lf\n", t64.d);
         } else {
             fprintf(stdout, " bf%i\n", (int)inner_size);
         }
         break;
+    case YA_NODE_TYPE_DECIMAL_FLOAT:
+        if (ya_cursor_uint64(cursor, &t64.u) == 0) {
+            print_decimal(t64.u, 64);
+        } else if (ya_cursor_uint128(cursor, &t128) == 0) {
+            print_decimal(t128, 128);
+        } else {
+            fprintf(stdout, " df%i\n", (int)inner_size);
+        }
+        break;
     case YA_NODE_TYPE_TEXT:
-        s = strndup(node->data, inner_size);
-        fprintf(stdout, " \"%s\"\n", s);
-        free(s);
+        s = ya_cursor_text(cursor, &s_length);
+        fprintf(stdout, " \"%.*s\"\n", (int)s_length, s);
         break;
     case YA_NODE_TYPE_NULL:
         fprintf(stdout, " pass\n");
         break;
+    case YA_NODE_TYPE_INDEX:
+        // The index starts with the number of nodes.
+        if (inner_size >= sizeof (t64)) {
+            memcpy(t64.c, ya_cursor_data(cursor), sizeof (t64));
+            fprintf(stdout, " index of %llu nodes\n", (unsigned long long)ntohll(t64.u));
+        } else {
+            fprintf(stdout, " index\n");
+        }
+        break;
     case YA_NODE_TYPE_BRANCH:
-        // we continue until a header will not fit in the data anymore.
-        fprintf(stdout, "\n");
-        while (inner_offset < inner_size) {
-            // decode the inner nodes.
-            inner_offset+= node_decode(&node->data[inner_offset], inner_size - inner_offset, level + 1);
+        if (ya_cursor_flags(cursor) & YA_HEADER_FLAG_UTF8) {
+            fprintf(stdout, " utf8");
         }
+        // The children are printed on the next lines.
+        fprintf(stdout, "\n");
         break;
     default:
         fprintf(stderr, " *unknown*\n");
         break;
     }
-
-    // Return the actual size occupied.
-    return ya_align64(ntohll(node->size));
 }
 
 int main(int argc, char *argv[])
 {
-    int         fd;
-    struct stat fd_st;
-    char        *buf;
-    size_t      buf_size;
-
-    if (argc != 2) {
-        fprintf(stderr, "Expect 1 filename as argument.\n");
+    ya_reader_t reader;
+    ya_cursor_t root;
+    ya_cursor_t cursor;
+    ya_walker_t walker;
+    size_t      level;
+    int         r;
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Expect 1 filename as argument, optionally followed by the number of the node to print.\n");
         exit(1);
     }
 
-    if ((fd = open(argv[1], O_RDONLY)) == -1) {
+    if (ya_reader_open(&reader, argv[1]) == -1) {
         perror("Failed to open file.");
         exit(1);
     }
 
-    if (fstat(fd, &fd_st) == -1) {
-        perror("Could not stat the file.");
+    if (argc == 3) {
+        // Only print a single node and its children, the index is used when the file has one.
+        if ((r = ya_reader_node(&reader, strtoull(argv[2], NULL, 10), &root)) == 0) {
+            fprintf(stderr, "There is no node %s.\n", argv[2]);
+            exit(1);
+        }
+    } else {
+        r = ya_reader_root(&reader, &root);
+    }
+    if (r == -1) {
+        // We use stdout, so that the error is synchronized to the output data.
+        fprintf(stdout, "!error node does not fit in the file.\n");
         exit(1);
     }
-    buf_size = fd_st.st_size;
 
-    if ((buf = mmap(0, buf_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0)) == MAP_FAILED) {
-        perror("Could not map the file in memory.");
+    if (ya_walker_init(&walker, &root) == -1) {
+        perror("Could not allocate the walker.");
         exit(1);
     }
 
-    // Start decoding the file.
-    (void)node_decode(buf, buf_size, 0);
-
-    if (munmap(buf, buf_size) == -1) {
-        perror("Could not unmap the file from memory.");
-        exit(1);
+    // Print the nodes depth first, without recursion.
+    while ((r = ya_walker_next(&walker, &cursor, &level)) == 1) {
+        print_node(&cursor, level);
     }
 
-    if (close(fd) == -1) {
-        perror("Close the file.");
+    if (r == -1) {
+        fprintf(stdout, "!error %s.\n", errno == EINVAL ? "node does not fit in its parent" : strerror(errno));
         exit(1);
     }
-}
 
+    ya_walker_free(&walker);
+    ya_reader_close(&reader);
+    return 0;
+}
@@ -26,6 +26,7 @@
 #define YA_YYAST_H
 
 #include <yyast/types.h>
+#include <yyast/context.h>
 #include <yyast/utils.h>
 #include <yyast/count.h>
 #include <yyast/node.h>
@@ -33,5 +34,9 @@
 #include <yyast/header.h>
 #include <yyast/error.h>
 #include <yyast/main.h>
+#include <yyast/arena.h>
+#include <yyast/real.h>
+#include <yyast/utf8.h>
+#include <yyast/index.h>
 
 #endif
@@ -0,0 +1,119 @@
+/* Copyright (c) 2011-2013, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef YA_YYAST_HPP
+#define YA_YYAST_HPP
+
+/** C++ interface of YYAST.
+ * Grammars compiled as C++ can include this header instead of yyast.h. The names of
+ * branches are computed at compile time, and the children of a branch are passed as an
+ * array whose length is known at compile time, instead of through a va_list.
+ * The output is identical to the output of the C interface.
+ */
+
+#include <cstddef>
+
+extern "C" {
+#include <yyast/yyast.h>
+}
+
+/** The parser and its input, which ya_main() and ya_parse_buffer() use with C linkage.
+ * The parser generated by bison's C skeleton, and a scanner, get C linkage from these
+ * declarations when they are compiled as C++ in a file which includes this header.
+ */
+extern "C" int yyparse(void);
+extern "C" FILE *yyin;
+
+namespace yyast {
+
+namespace detail {
+
+/** Pack the characters of a name in a ya_name_t, in the same way as ya_create_name().
+ */
+constexpr ya_name_t pack_name(const char *s, std::size_t length, std::size_t i, ya_name_t name)
+{
+    return i == sizeof (ya_name_t) ?
+        name :
+        pack_name(s, length, i + 1, (name << 8) | (i < length ? static_cast<ya_name_t>(s[i]) : static_cast<ya_name_t>(' ')));
+}
+
+/** Create a node with a name that is known at compile time.
+ */
+template <ya_name_t Name, ya_type_t Type, typename... Children>
+inline ya_t node(Children *... children)
+{
+    // One extra element, so that the array is not empty when there are no children.
+    ya_t    *items[sizeof... (Children) + 1] = {children..., NULL};
+
+    return ya_node_array(Name, Type, items, sizeof... (Children));
+}
+
+}
+
+/** Convert a string literal to a name at compile time.
+ * Names which do not fit in the eight characters of a ya_name_t are rejected at compile time.
+ *
+ * @param s     The name, as a string literal.
+ * @returns     The name, with trailing spaces.
+ */
+template <std::size_t N>
+constexpr ya_name_t name(const char (&s)[N])
+{
+    static_assert(N - 1 <= sizeof (ya_name_t), "The name of a node must not be longer than 8 characters.");
+    return detail::pack_name(s, N - 1, 0, 0);
+}
+
+/** Create a branch, see ya_branch().
+ * @tparam Name     Name of the branch, use yyast::name() to create it.
+ * @param children  Pointers to the children.
+ */
+template <ya_name_t Name, typename... Children>
+inline ya_t branch(Children *... children)
+{
+    return detail::node<Name, YA_NODE_TYPE_BRANCH>(children...);
+}
+
+/** Create a list, see ya_list().
+ * @param children  Pointers to the children.
+ */
+template <typename... Children>
+inline ya_t list(Children *... children)
+{
+    return detail::node<name("@list"), YA_NODE_TYPE_LIST>(children...);
+}
+
+}
+
+// Replace the macros of node.h, so that a grammar does not need to be changed.
+#undef YA_BRANCH
+#undef YA_EMPTYBRANCH
+#undef YA_LIST
+#undef YA_EMPTYLIST
+
+#define YA_BRANCH(node_name, ...)   yyast::branch<yyast::name(node_name)>(__VA_ARGS__)
+#define YA_EMPTYBRANCH(node_name)   yyast::branch<yyast::name(node_name)>()
+#define YA_LIST(...)                yyast::list(__VA_ARGS__)
+#define YA_EMPTYLIST                yyast::list()
+
+#endif